@@ -0,0 +1,315 @@
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Raster.h"
+#include "Shape.h"
+#include "SceneFile.h"
+
+// Batch renders sketches with no window and no one at the mouse. It reads
+// commands from a file, or stdin if none is given, one per line, and
+// draws each shape into a CPU raster with the kernels in Algorithms.cpp
+// as soon as it's read, so streams of any length run in constant memory.
+//
+// Shapes use the text scene format (see SceneFile.h):
+//     line x0 y0 x1 y1
+//     circle x y radius
+//     curve x0 y0 x1 y1 x2 y2 x3 y3
+//     clock x y radius
+// (circles, clocks and curves ending in fill are filled)
+// and a few more commands control the output:
+//     size w h         start a new, blank sketch w by h pixels (up to
+//                      RASTER_MAX_SIDE a side)
+//     time h m s       clock hands show this time (the default is now)
+//     write path       write the sketch to path (PNG, or PPM if it ends in
+//                      .ppm) and start a new, blank one the same size
+// Blank lines and lines starting with # are skipped. Shapes drawn since
+// the last write are written to BATCH_PATH at the end.
+//
+// Shapes are drawn with the hard pixels the window draws. --smooth
+// anti-aliases them instead: coverage runs from the _aa kernels are
+// blended over the sketch, at several times the cost. With --throughput
+// nothing is written; Batch reports how fast shapes and sketches went
+// through instead.
+
+// Where whatever's left at the end of the stream goes
+const char BATCH_PATH[] = "batch.png";
+
+// Seconds on the high-resolution counter
+static double now(void){
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count.QuadPart / frequency.QuadPart;
+}
+
+// Does text end with suffix?
+static bool ends_with(const string &text, const char *suffix){
+	size_t length = strlen(suffix);
+	return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// Batch state: the sketch being drawn and what's been done so far
+class BatchRender{
+public:
+	BatchRender(bool throughput, bool smooth);
+	~BatchRender();
+
+	// Run one command. False if it couldn't be read.
+	bool command(const string &line);
+
+	// Write out anything drawn since the last write
+	bool finish(void);
+
+	size_t shapes;			// Shapes drawn
+	size_t sketches;		// Sketches finished
+	size_t failures;		// Images that didn't write
+
+private:
+	// Draw one shape with the same kernels the window uses, or their
+	// anti-aliased versions
+	void draw(Shape &shape);
+	void draw_smooth(Shape &shape);
+
+	// Blank sketch, w by h
+	void start(GLint w, GLint h);
+
+	// Write the sketch and start a new one
+	void write(const string &path);
+
+	bool throughput;		// Count, don't write
+	bool smooth;			// Anti-alias?
+	Raster *raster;
+	TimeAngle ta;
+	bool dirty;				// Drawn on since the last write?
+	vector<Point2D> points;	// Curve control points, reused
+	vector<Span> spans;		// Filled shapes' spans, reused
+	CoverageSpans runs;		// One shape's anti-aliased runs, reused
+
+	// No copying
+	BatchRender(BatchRender const&);
+	void operator=(BatchRender const&);
+};
+
+static tm *time_now(void){
+	time_t t = time(NULL);
+	return localtime(&t);
+}
+
+BatchRender::BatchRender(bool t, bool s):
+	shapes(0),
+	sketches(0),
+	failures(0),
+	throughput(t),
+	smooth(s),
+	raster(0),
+	ta(time_now()),
+	dirty(false),
+	points(),
+	spans(),
+	runs()
+{
+	start(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+}
+
+BatchRender::~BatchRender(){
+	delete raster;
+}
+
+// The old raster is only let go once the new one is allocated, so a
+// size that doesn't fit leaves the sketch as it was
+void BatchRender::start(GLint w, GLint h){
+	if(!raster || raster->width != w || raster->height != h){
+		Raster *sized = new Raster(w, h, RGBA32);
+		delete raster;
+		raster = sized;
+	}
+	raster->clear(BLACK);
+	raster->set_color(WHITE);
+	dirty = false;
+}
+
+void BatchRender::write(const string &path){
+	if(!throughput){
+		bool ok = ends_with(path, ".ppm") ? raster->write_ppm(path.c_str()) : raster->write_png(path.c_str());
+		if(!ok){
+			cerr << "can't write " << path << "\n";
+			++failures;
+		}
+	}
+	++sketches;
+	start(raster->width, raster->height);
+}
+
+// Filled shapes are spans from the scanline filler
+void BatchRender::draw(Shape &shape){
+	if(smooth){
+		draw_smooth(shape);
+		return;
+	}
+	if(shape.filled){
+		spans.clear();
+		shape_spans(shape, ta, spans);
+		raster->fill(spans);
+		++shapes;
+		dirty = true;
+		return;
+	}
+	switch(shape.kind){
+	case SHAPE_LINE:
+		make_line(shape.points[0], shape.points[1], *raster);
+		break;
+	case SHAPE_CIRCLE:
+		make_circle(shape.points[0], shape.radius, *raster);
+		break;
+	case SHAPE_CURVE:
+		points.assign(shape.points, shape.points + 4);
+		make_curve(points, *raster);
+		break;
+	case SHAPE_CLOCK:
+		make_circle(shape.points[0], shape.radius, *raster);
+		make_hands(shape.points[0], shape.radius, *raster, ta);
+		break;
+	}
+	++shapes;
+	dirty = true;
+}
+
+// Same shapes, as coverage runs blended in one go
+void BatchRender::draw_smooth(Shape &shape){
+	runs.clear();
+	if(shape.filled){
+		shape_coverage(shape, ta, runs);
+		raster->blend(runs);
+		++shapes;
+		dirty = true;
+		return;
+	}
+	switch(shape.kind){
+	case SHAPE_LINE:
+		make_line_aa(shape.points[0], shape.points[1], runs);
+		break;
+	case SHAPE_CIRCLE:
+		make_circle_aa(shape.points[0], shape.radius, runs);
+		break;
+	case SHAPE_CURVE:
+		points.assign(shape.points, shape.points + 4);
+		make_curve_aa(points, runs);
+		break;
+	case SHAPE_CLOCK:
+		make_circle_aa(shape.points[0], shape.radius, runs);
+		make_hands_aa(shape.points[0], shape.radius, runs, ta);
+		break;
+	}
+	raster->blend(runs);
+	++shapes;
+	dirty = true;
+}
+
+bool BatchRender::command(const string &line){
+	istringstream fields(line);
+	string name;
+	if(!(fields >> name) || name[0] == '#'){
+		return true;
+	}
+	if(name == "size"){
+		GLint w = 0, h = 0;
+		fields >> w >> h;
+		if(fields.fail() || w <= 0 || h <= 0 || w > RASTER_MAX_SIDE || h > RASTER_MAX_SIDE){
+			return false;
+		}
+		try{
+			start(w, h);
+		}catch(bad_alloc &){
+			return false;
+		}
+		return true;
+	}
+	if(name == "time"){
+		tm at = *time_now();
+		fields >> at.tm_hour >> at.tm_min >> at.tm_sec;
+		if(fields.fail()){
+			return false;
+		}
+		ta = TimeAngle(&at);
+		return true;
+	}
+	if(name == "write"){
+		string path;
+		if(!(fields >> path)){
+			return false;
+		}
+		write(path);
+		return true;
+	}
+	Shape shape;
+	if(!parse_shape(name, fields, shape)){
+		return false;
+	}
+	draw(shape);
+	return true;
+}
+
+bool BatchRender::finish(void){
+	if(dirty){
+		write(BATCH_PATH);
+	}
+	return failures == 0;
+}
+
+int main(int argc, char **argv){
+	bool throughput = false;
+	bool smooth = false;
+	const char *path = 0;
+	for(int i = 1; i < argc; ++i){
+		if(strcmp(argv[i], "--throughput") == 0){
+			throughput = true;
+		}else if(strcmp(argv[i], "--smooth") == 0){
+			smooth = true;
+		}else if(strcmp(argv[i], "-") != 0){
+			path = argv[i];
+		}
+	}
+
+	ifstream file;
+	if(path){
+		file.open(path);
+		if(!file){
+			cerr << "can't open " << path << "\n";
+			return 1;
+		}
+	}
+	ios::sync_with_stdio(false);
+	istream &in = path ? (istream&)file : cin;
+
+	// Lines that don't read are reported and skipped, so one bad shape
+	// doesn't lose the rest of a long job
+	BatchRender batch(throughput, smooth);
+	double started = now();
+	size_t number = 0, errors = 0;
+	string line;
+	while(getline(in, line)){
+		++number;
+		if(!batch.command(line)){
+			cerr << "line " << number << ": can't read \"" << line << "\"\n";
+			++errors;
+		}
+	}
+	bool written = batch.finish();
+	double elapsed = now() - started;
+
+	if(throughput){
+		cout << batch.shapes << " shapes, " << batch.sketches << " sketches in " << elapsed << " s: "
+			<< batch.shapes / elapsed << " shapes/s, " << batch.sketches * 60.0 / elapsed << " sketches/min\n";
+	}
+	return errors || !written ? 1 : 0;
+}
@@ -0,0 +1,453 @@
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Simd.h"
+
+// Benchmark times the drawing kernels in Algorithms.cpp on their own, with
+// no window or GL context. Every case runs until MIN_SECONDS have passed
+// and reports time per primitive and pixels per second. Pass --csv for
+// machine-readable output, or --check to test the size functions the
+// kernels reserve with, and the SIMD kernels against the scalar ones, on
+// random lines and circles instead.
+
+// Minimum wall time spent on each case
+const double MIN_SECONDS = 0.05;
+
+// Calls between clock reads
+const GLint BATCH = 16;
+
+// Seconds on the high-resolution counter
+static double now(void){
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (double)count.QuadPart / frequency.QuadPart;
+}
+
+// Each case draws one primitive into pixels (or a raster) per call and
+// returns how many pixels that was.
+struct Case{
+	virtual ~Case() {}
+	virtual size_t run(vector<Point2D> &pixels, Raster &raster) = 0;
+};
+
+struct LineCase : Case{
+	enum Variant { BRANCHLESS, BRANCHY, SPANS, RASTER, SIMD, DIRECT, AA };
+	LineCase(Point2D a, Point2D b, Variant v): p0(a), p1(b), variant(v), vertices(2 * line_size(a, b)) {}
+	size_t run(vector<Point2D> &pixels, Raster &raster){
+		GLint length = max(abs(p1.x - p0.x), abs(p1.y - p0.y)) + 1;
+		switch(variant){
+		case BRANCHLESS:
+			make_line(p0, p1, pixels);
+			break;
+		case BRANCHY:
+			make_line_branchy(p0, p1, pixels);
+			break;
+		case SPANS:
+			spans.clear();
+			make_line_spans(p0, p1, spans);
+			break;
+		case RASTER:
+			make_line(p0, p1, raster);
+			break;
+		case SIMD:
+			make_line_simd(p0, p1, pixels);
+			break;
+		case DIRECT:
+			writer = VertexWriter(&vertices[0]);
+			make_line(p0, p1, writer);
+			break;
+		case AA:
+			runs.clear();
+			make_line_aa(p0, p1, runs);
+			raster.blend(runs);
+			break;
+		}
+		return length;
+	}
+	Point2D p0, p1;
+	Variant variant;
+	vector<Span> spans;
+	CoverageSpans runs;
+	vector<GLfloat> vertices;
+	VertexWriter writer;
+};
+
+struct CircleCase : Case{
+	enum Variant { BRANCHLESS, BRANCHY, SPANS, RASTER, SIMD, DIRECT, AA };
+	CircleCase(GLint r, Variant v): radius(r), variant(v), count(0), vertices(2 * circle_size(r)) {
+		vector<Point2D> pixels;
+		make_circle(Point2D(DEFAULT_WIDTH / 2, DEFAULT_HEIGHT / 2), radius, pixels);
+		count = pixels.size();
+	}
+	size_t run(vector<Point2D> &pixels, Raster &raster){
+		Point2D center(DEFAULT_WIDTH / 2, DEFAULT_HEIGHT / 2);
+		switch(variant){
+		case BRANCHLESS:
+			make_circle(center, radius, pixels);
+			break;
+		case BRANCHY:
+			make_circle_branchy(center, radius, pixels);
+			break;
+		case SPANS:
+			spans.clear();
+			make_circle_spans(center, radius, spans);
+			break;
+		case RASTER:
+			make_circle(center, radius, raster);
+			break;
+		case SIMD:
+			make_circle_simd(center, radius, pixels);
+			break;
+		case DIRECT:
+			writer = VertexWriter(&vertices[0]);
+			make_circle(center, radius, writer);
+			break;
+		case AA:
+			runs.clear();
+			make_circle_aa(center, radius, runs);
+			raster.blend(runs);
+			break;
+		}
+		return count;
+	}
+	GLint radius;
+	Variant variant;
+	size_t count;
+	vector<Span> spans;
+	CoverageSpans runs;
+	vector<GLfloat> vertices;
+	VertexWriter writer;
+};
+
+struct CurveCase : Case{
+	CurveCase(GLint size, bool a): adaptive(a) {
+		control_points.push_back(Point2D(0, 0));
+		control_points.push_back(Point2D(0, size));
+		control_points.push_back(Point2D(size, size));
+		control_points.push_back(Point2D(size, 0));
+	}
+	size_t run(vector<Point2D> &pixels, Raster &raster){
+		if(adaptive){
+			make_curve(control_points, pixels);
+		}else{
+			make_curve_uniform(control_points, 40, pixels);
+		}
+		return pixels.size();
+	}
+	vector<Point2D> control_points;
+	bool adaptive;
+};
+
+// Filled shapes size pixels across: a disc, or a five-pointed star of
+// quadratic curves drawn point to point, whose middle is wound round
+// twice, so the two rules fill it differently
+struct FillCase : Case{
+	enum Variant { DISC, EVEN_ODD, NON_ZERO };
+	FillCase(GLint s, Variant v): size(s), variant(v) {
+		GLfloat r = size / 2.0f;
+		for(GLint k = 0; k <= 5; ++k){
+			GLfloat a = (-90.0f + 144.0f * k) * PI_OVER_180;
+			GLfloat b = (-18.0f + 144.0f * k) * PI_OVER_180;
+			control_points.push_back(Point2D((GLint)(r + r * cos(a)), (GLint)(r + r * sin(a))));
+			if(k < 5){
+				control_points.push_back(Point2D((GLint)(r - 0.6f * r * cos(b)), (GLint)(r - 0.6f * r * sin(b))));
+			}
+		}
+	}
+	size_t run(vector<Point2D> &pixels, Raster &raster){
+		spans.clear();
+		switch(variant){
+		case DISC:
+			make_disc_spans(Point2D(DEFAULT_WIDTH / 2, DEFAULT_HEIGHT / 2), size / 2, spans);
+			break;
+		case EVEN_ODD:
+			make_closed_path_spans(control_points, 2, FILL_EVEN_ODD, spans);
+			break;
+		case NON_ZERO:
+			make_closed_path_spans(control_points, 2, FILL_NON_ZERO, spans);
+			break;
+		}
+		size_t count = 0;
+		for(size_t i = 0; i < spans.size(); ++i){
+			count += spans[i].x1 - spans[i].x0 + 1;
+		}
+		return count;
+	}
+	GLint size;
+	Variant variant;
+	vector<Point2D> control_points;
+	vector<Span> spans;
+};
+
+struct HandsCase : Case{
+	HandsCase(GLint r): radius(r) {
+		time_t t = time(NULL);
+		ta = new TimeAngle(localtime(&t));
+	}
+	~HandsCase(){
+		delete ta;
+	}
+	size_t run(vector<Point2D> &pixels, Raster &raster){
+		make_hands(Point2D(DEFAULT_WIDTH / 2, DEFAULT_HEIGHT / 2), radius, pixels, *ta);
+		return pixels.size();
+	}
+	GLint radius;
+	TimeAngle *ta;
+};
+
+// Print one result as an aligned row or a CSV line
+static void report(bool csv, const string &kernel, const string &variant, const string &param, double ns, double pixels_per_second){
+	if(csv){
+		cout << kernel << "," << variant << "," << param << "," << ns << "," << pixels_per_second << "\n";
+	}else{
+		cout << left << setw(8) << kernel << setw(12) << variant << setw(18) << param
+			<< right << fixed << setprecision(1) << setw(12) << ns << " ns/prim"
+			<< setw(10) << pixels_per_second / 1e6 << " Mpix/s\n";
+	}
+}
+
+// Run a case for at least MIN_SECONDS
+static void measure(bool csv, const string &kernel, const string &variant, const string &param, Case &c){
+	vector<Point2D> pixels;
+	Raster raster(DEFAULT_WIDTH, DEFAULT_HEIGHT, GRAY8);
+	size_t calls = 0, pixel_count = 0;
+	double start = now(), elapsed = 0.0;
+	do{
+		for(GLint i = 0; i < BATCH; ++i){
+			pixels.clear();
+			pixel_count += c.run(pixels, raster);
+		}
+		calls += BATCH;
+		elapsed = now() - start;
+	}while(elapsed < MIN_SECONDS);
+	report(csv, kernel, variant, param, elapsed * 1e9 / calls, pixel_count / elapsed);
+}
+
+// Random coordinate within range pixels of 0, in C
+template<class C>
+static typename C::Value random_coord(GLint range){
+	long long pixels = (long long)(rand() % (2 * range + 1)) - range;
+	return (typename C::Value)((pixels << C::FRACTION_BITS) + (rand() & ((1 << C::FRACTION_BITS) - 1)));
+}
+
+// line_size has to be exact and line_spans_size an upper bound. Returns
+// the number of lines that broke either, reporting the first few.
+template<class C>
+static size_t check_line_sizes(const char *name, size_t lines){
+	vector<Point2D> pixels;
+	vector<Span> spans;
+	size_t failures = 0;
+	for(size_t i = 0; i < lines; ++i){
+		GLint range = i % 2 ? 100 : 20000;
+		CoordPoint<C> p0(random_coord<C>(range), random_coord<C>(range));
+		CoordPoint<C> p1(random_coord<C>(range), random_coord<C>(range));
+		pixels.clear();
+		spans.clear();
+		make_line(p0, p1, pixels);
+		make_line_spans(p0, p1, spans);
+		if(pixels.size() != line_size(p0, p1) || spans.size() > line_spans_size(p0, p1)){
+			if(++failures <= 5){
+				cout << name << " (" << p0.x << "," << p0.y << ")-(" << p1.x << "," << p1.y << "): "
+					<< pixels.size() << " pixels, " << spans.size() << " spans, sizes "
+					<< line_size(p0, p1) << " and " << line_spans_size(p0, p1) << "\n";
+			}
+		}
+	}
+	return failures;
+}
+
+// hands_size has to be exact and circle_size an upper bound, at random
+// times and radii
+static size_t check_clock_sizes(size_t clocks){
+	vector<Point2D> pixels;
+	size_t failures = 0;
+	for(size_t i = 0; i < clocks; ++i){
+		tm at = {};
+		at.tm_hour = rand() % 24;
+		at.tm_min = rand() % 60;
+		at.tm_sec = rand() % 60;
+		TimeAngle ta(&at, rand() % 1000);
+		Point2D center(rand() % 4001 - 2000, rand() % 4001 - 2000);
+		GLint radius = rand() % 3000;
+		pixels.clear();
+		make_hands(center, radius, pixels, ta);
+		bool hands_ok = pixels.size() == hands_size(center, radius, ta);
+		pixels.clear();
+		make_circle(center, radius, pixels);
+		if((!hands_ok || pixels.size() > circle_size(radius)) && ++failures <= 5){
+			cout << "clock (" << center.x << "," << center.y << ") r=" << radius << " at "
+				<< at.tm_hour << ":" << at.tm_min << ":" << at.tm_sec << " over its sizes\n";
+		}
+	}
+	return failures;
+}
+
+// Scalar and SIMD output side by side: the pixels, in the same order,
+// and the same number of them
+static bool same_output(const vector<Point2D> &scalar, const vector<Point2D> &simd,
+	const vector<GLfloat> &scalar_vertices, const vector<GLfloat> &simd_vertices){
+	bool same = scalar.size() == simd.size() && scalar_vertices == simd_vertices;
+	for(size_t i = 0; same && i < scalar.size(); ++i){
+		same = scalar[i].x == simd[i].x && scalar[i].y == simd[i].y;
+	}
+	return same;
+}
+
+// Vertices from one kernel, with room for count pixels, trimmed to what
+// it wrote
+template<class Draw>
+static void write_vertices(size_t count, Draw draw, vector<GLfloat> &vertices){
+	vertices.assign(2 * count, 0.0f);
+	VertexWriter writer(&vertices[0]);
+	draw(writer);
+	vertices.resize(writer.next - &vertices[0]);
+}
+
+struct LineDraw{
+	Point2D p0, p1;
+	bool simd;
+	void operator()(VertexWriter &w) const { simd ? make_line_simd(p0, p1, w) : make_line(p0, p1, w); }
+};
+
+struct CircleDraw{
+	Point2D center;
+	GLint radius;
+	bool simd;
+	void operator()(VertexWriter &w) const { simd ? make_circle_simd(center, radius, w) : make_circle(center, radius, w); }
+};
+
+// The SIMD kernels have to match the scalar ones bit for bit, into both
+// pixel vectors and vertices, for random lines and circles. Returns the
+// number that differ, reporting the first few.
+static size_t check_simd(size_t lines, size_t circles){
+	vector<Point2D> scalar, simd;
+	vector<GLfloat> scalar_vertices, simd_vertices;
+	size_t failures = 0;
+	for(size_t i = 0; i < lines; ++i){
+		GLint range = i % 2 ? 100 : 20000;
+		LineDraw line = {Point2D(random_coord<Int32Coords>(range), random_coord<Int32Coords>(range)),
+			Point2D(random_coord<Int32Coords>(range), random_coord<Int32Coords>(range)), false};
+		scalar.clear();
+		simd.clear();
+		make_line(line.p0, line.p1, scalar);
+		make_line_simd(line.p0, line.p1, simd);
+		write_vertices(line_size(line.p0, line.p1), line, scalar_vertices);
+		line.simd = true;
+		write_vertices(line_size(line.p0, line.p1), line, simd_vertices);
+		if(!same_output(scalar, simd, scalar_vertices, simd_vertices) && ++failures <= 5){
+			cout << "line (" << line.p0.x << "," << line.p0.y << ")-(" << line.p1.x << "," << line.p1.y << "): simd differs\n";
+		}
+	}
+	for(size_t i = 0; i < circles; ++i){
+		CircleDraw circle = {Point2D(rand() % 4001 - 2000, rand() % 4001 - 2000), i % 2 ? rand() % 100 : rand() % 5000, false};
+		scalar.clear();
+		simd.clear();
+		make_circle(circle.center, circle.radius, scalar);
+		make_circle_simd(circle.center, circle.radius, simd);
+		write_vertices(circle_size(circle.radius), circle, scalar_vertices);
+		circle.simd = true;
+		write_vertices(circle_size(circle.radius), circle, simd_vertices);
+		if(!same_output(scalar, simd, scalar_vertices, simd_vertices) && ++failures <= 5){
+			cout << "circle (" << circle.center.x << "," << circle.center.y << ") r=" << circle.radius << ": simd differs\n";
+		}
+	}
+	return failures;
+}
+
+static int run_checks(void){
+	const size_t LINES = 200000;
+	const size_t CLOCKS = 20000;
+	const size_t CIRCLES = 20000;
+	srand(1);
+	size_t failures = check_line_sizes<Int32Coords>("int32", LINES)
+		+ check_line_sizes<Int64Coords>("int64", LINES)
+		+ check_line_sizes<Fixed24_8Coords>("24.8", LINES)
+		+ check_clock_sizes(CLOCKS);
+	cout << failures << " of " << 3 * LINES + CLOCKS << " lines and clocks over their sizes\n";
+	size_t simd_failures = check_simd(LINES, CIRCLES);
+	cout << simd_failures << " of " << LINES + CIRCLES << " lines and circles where simd and scalar differ";
+#ifdef SKETCH_SSE2
+	bool vectorized = use_sse2();
+#else
+	bool vectorized = false;
+#endif
+	cout << (vectorized ? "\n" : " (no SSE2, both scalar)\n");
+	return failures || simd_failures ? 1 : 0;
+}
+
+int main(int argc, char **argv){
+	if(argc > 1 && strcmp(argv[1], "--check") == 0){
+		return run_checks();
+	}
+	bool csv = argc > 1 && strcmp(argv[1], "--csv") == 0;
+	if(csv){
+		cout << "kernel,variant,param,ns_per_primitive,pixels_per_second\n";
+	}
+
+	// Lines: every slope from flat to vertical, short to long
+	static const char *line_variants[] = {"branchless", "branchy", "spans", "raster", "simd", "direct", "aa"};
+	static const GLint lengths[] = {16, 128, 1024};
+	for(size_t l = 0; l < sizeof(lengths) / sizeof(GLint); ++l){
+		for(GLint degrees = 0; degrees <= 90; degrees += 15){
+			Point2D p0(0, 0);
+			Point2D p1((GLint)(lengths[l] * cos(degrees * PI_OVER_180)), (GLint)(lengths[l] * sin(degrees * PI_OVER_180)));
+			ostringstream param;
+			param << "len=" << lengths[l] << " deg=" << degrees;
+			for(GLint v = 0; v < 7; ++v){
+				LineCase c(p0, p1, (LineCase::Variant)v);
+				measure(csv, "line", line_variants[v], param.str(), c);
+			}
+		}
+	}
+
+	// Circles
+	static const GLint radii[] = {4, 16, 64, 256, 1024};
+	for(size_t r = 0; r < sizeof(radii) / sizeof(GLint); ++r){
+		ostringstream param;
+		param << "r=" << radii[r];
+		for(GLint v = 0; v < 7; ++v){
+			CircleCase c(radii[r], (CircleCase::Variant)v);
+			measure(csv, "circle", line_variants[v], param.str(), c);
+		}
+	}
+
+	// Curves, adaptive against the old fixed 40 segments
+	static const GLint sizes[] = {16, 128, 1024};
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(GLint); ++s){
+		ostringstream param;
+		param << "size=" << sizes[s];
+		CurveCase adaptive(sizes[s], true);
+		measure(csv, "curve", "adaptive", param.str(), adaptive);
+		CurveCase uniform(sizes[s], false);
+		measure(csv, "curve", "uniform40", param.str(), uniform);
+	}
+
+	// Filled shapes
+	static const char *fill_variants[] = {"disc", "evenodd", "nonzero"};
+	for(size_t s = 0; s < sizeof(sizes) / sizeof(GLint); ++s){
+		ostringstream param;
+		param << "size=" << sizes[s];
+		for(GLint v = 0; v < 3; ++v){
+			FillCase c(sizes[s], (FillCase::Variant)v);
+			measure(csv, "fill", fill_variants[v], param.str(), c);
+		}
+	}
+
+	// Clock hands
+	for(size_t r = 0; r < sizeof(radii) / sizeof(GLint); ++r){
+		ostringstream param;
+		param << "r=" << radii[r];
+		HandsCase c(radii[r]);
+		measure(csv, "hands", "lines", param.str(), c);
+	}
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -7,71 +8,265 @@ using namespace std;
 
 // Write pixel to pixel vector
 void set_pixel(int x, int y, vector<Point2D> &pixels){
-	pixels.push_back(Point2D(x, HEIGHT - y));
+	pixels.push_back(Point2D(x, y));
 }
 
 // Write pixel to pixel vector swapping x and y
 void swap_set_pixel(int x, int y, vector<Point2D> &pixels){
-	pixels.push_back(Point2D(y, HEIGHT - x));
+	pixels.push_back(Point2D(y, x));
+}
+
+// Write pixel to framebuffer
+void set_pixel(int x, int y, Raster &pixels){
+	pixels.plot(x, y);
+}
+
+// Write pixel to framebuffer swapping x and y
+void swap_set_pixel(int x, int y, Raster &pixels){
+	pixels.plot(y, x);
+}
+
+// Write pixel as a vertex
+void set_pixel(int x, int y, VertexWriter &pixels){
+	pixels.next[0] = (GLfloat)x;
+	pixels.next[1] = (GLfloat)y;
+	pixels.next += 2;
+}
+
+// Write pixel as a vertex swapping x and y
+void swap_set_pixel(int x, int y, VertexWriter &pixels){
+	pixels.next[0] = (GLfloat)y;
+	pixels.next[1] = (GLfloat)x;
+	pixels.next += 2;
+}
+
+// Grow geometrically even when called once per segment, so a long
+// polyline doesn't reallocate for every line in it
+template<class T>
+static void reserve_more(size_t n, vector<T> &v){
+	size_t needed = v.size() + n;
+	if(needed > v.capacity()){
+		v.reserve(needed > 2 * v.capacity() ? needed : 2 * v.capacity());
+	}
+}
+
+void reserve_pixels(size_t n, vector<Point2D> &pixels){
+	reserve_more(n, pixels);
+}
+
+// Division rounding up, for positive b
+template<class W>
+static inline W ceil_div(W a, W b){
+	return a >= 0 ? (a + b - 1) / b : -(-a / b);
+}
+
+// The midpoint line walk for any coordinate system, set up the way the
+// textbook sets it up: x is the major axis, x only increases, and step_y
+// mirrors y so it only increases too. The walk visits one column per
+// step and moves up a row when the line passes strictly above the
+// midpoint between the two candidates, so halves go back toward p0.
+//
+// The first row comes from the exact end point rather than a rounded
+// one, and d is scaled by 2^FRACTION_BITS, so fixed point lines land
+// where the true line is. For whole pixels the setup comes out as the
+// textbook's d = 2 * dy - dx. Everything is worked relative to the
+// pixels nearest p0, so only the line's extent, not its position, has
+// to fit in Wide.
+template<class C>
+struct LineWalk{
+	typedef typename C::Wide Wide;
+
+	bool steep;			// Is y the major axis? Then x and y are swapped.
+	Wide x;				// First and last columns
+	Wide end;
+	Wide y;				// First row
+	Wide step_y;		// Rows go up (1) or down (-1)
+	Wide d;				// Decision variable: step the row when positive
+	Wide dE;			// Added to d when the row stays
+	Wide dNE;			// Added to d when it steps
+
+	LineWalk(CoordPoint<C> p0, CoordPoint<C> p1);
+
+	// Pixels in the line
+	size_t size(void) const { return (size_t)(end - x + 1); }
+};
+
+template<class C>
+LineWalk<C>::LineWalk(CoordPoint<C> p0, CoordPoint<C> p1){
+	const Wide one = (Wide)1 << C::FRACTION_BITS;
+	Wide x0 = p0.x, y0 = p0.y, x1 = p1.x, y1 = p1.y;
+	Wide dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	Wide dy = y1 > y0 ? y1 - y0 : y0 - y1;
+	steep = dy > dx;
+	if(steep){
+		swap(dx, dy);
+		swap(x0, y0);
+		swap(x1, y1);
+	}
+	if(x0 > x1){
+		swap(x0, x1);
+		swap(y0, y1);
+	}
+	step_y = y0 > y1 ? -1 : 1;
+	x = to_pixel<C>(x0);
+	end = to_pixel<C>(x1);
+	dE = 2 * one * dy;
+	dNE = 2 * one * (dy - dx);
+
+	// The first row is the lowest one whose top half clears the line at
+	// column x, counted from the nearest row to p0
+	Wide mirrored = step_y * y0;
+	Wide base = to_pixel<C>(mirrored);
+	if(dx == 0){
+		y = step_y * base;
+		d = 0;
+		return;
+	}
+	Wide n = (2 * (mirrored - base * one) - one) * dx + 2 * (x * one - x0) * dy;
+	Wide rows = ceil_div(n, 2 * one * dx);
+	y = step_y * (base + rows);
+	d = n - 2 * one * dx * rows + dE;
+}
+
+// One pixel per step along the major axis
+template<class C>
+size_t line_size(CoordPoint<C> p0, CoordPoint<C> p1){
+	return LineWalk<C>(p0, p1).size();
+}
+
+size_t line_size(Point2D p0, Point2D p1){
+	return line_size(to_coord<Int32Coords>(p0), to_coord<Int32Coords>(p1));
+}
+
+// The walk stops by the time x reaches r / sqrt(2), and every column
+// gives at most eight pixels
+size_t circle_size(GLint radius){
+	return 8 * ((size_t)(radius * 0.70710678) + 2);
+}
+
+// Same skipping as make_polyline
+template<class P>
+size_t polyline_size(vector<P> &polyline){
+	size_t count = polyline.size() == 1 ? 1 : 0;
+	for(size_t i = 1; i < polyline.size(); ++i){
+		if(polyline[i].x != polyline[i - 1].x || polyline[i].y != polyline[i - 1].y || i == 1){
+			count += line_size(polyline[i - 1], polyline[i]);
+		}
+	}
+	return count;
+}
+
+// Same end points as make_hands, so exact like line_size
+size_t hands_size(Point2D center, GLint radius, TimeAngle &ta){
+	SubpixelPoint from = to_coord<Fixed24_8Coords>(center);
+	return line_size(from, hand_end(center, radius, ta.hour_cos, ta.hour_sin))
+		+ line_size(from, hand_end(center, radius, ta.min_cos, ta.min_sin))
+		+ line_size(from, hand_end(center, radius, ta.sec_cos, ta.sec_sin));
+}
+
+// A run ends each time the minor axis steps. Between pixels, the walk's
+// first and last rows can each be one off the nearest to their end
+// point, hence a spare for each.
+template<class C>
+size_t line_spans_size(CoordPoint<C> p0, CoordPoint<C> p1){
+	typename C::Wide dx = to_pixel<C>(p1.x) - to_pixel<C>(p0.x);
+	typename C::Wide dy = to_pixel<C>(p1.y) - to_pixel<C>(p0.y);
+	dx = dx < 0 ? -dx : dx;
+	dy = dy < 0 ? -dy : dy;
+	return (size_t)(dx < dy ? dx : dy) + 1 + (C::FRACTION_BITS > 0 ? 2 : 0);
+}
+
+size_t line_spans_size(Point2D p0, Point2D p1){
+	return line_spans_size(to_coord<Int32Coords>(p0), to_coord<Int32Coords>(p1));
+}
+
+// No more runs than columns, eight spans each
+size_t circle_spans_size(GLint radius){
+	return circle_size(radius);
 }
 
 // Midpoint line drawing algorithm. Largely from textbook plus modifications
-// for drawing in all octants.
-void make_line(Point2D p0, Point2D p1, vector<Point2D> &pixels){
+// for drawing in all octants, and for any coordinate system (see
+// LineWalk).
+template<class C, class Out>
+void make_line(CoordPoint<C> p0, CoordPoint<C> p1, Out &pixels){
+	typedef typename C::Wide Wide;
+	LineWalk<C> walk(p0, p1);
+	reserve_pixels(walk.size(), pixels);
+
+	// Avoid branching in the loop. Steep lines were walked from y0 to y1
+	// instead of x0 to x1, so they're swapped back on the way out.
+	void(*draw_pixel)(GLint x, GLint y, Out &pixels) = set_pixel;
+	if(walk.steep){
+		draw_pixel = swap_set_pixel;
+	}
+
+	Wide x = walk.x, y = walk.y;
+	Wide d = walk.d;
+	draw_pixel((GLint)x, (GLint)y, pixels);
+	while(x < walk.end){
+		/*if(d <= 0){
+			d += dE;
+		}else{
+			d += dNE;
+			y += step_y;
+		}*/
+
+		// Branchless version
+		x += 1;
+		bool east = d <= 0;
+		bool northeast = !east;
+		// Go east or northeast
+		d += walk.dE * east + walk.dNE * northeast;
+		y += walk.step_y * northeast;
+
+		draw_pixel((GLint)x, (GLint)y, pixels);
+	}
+}
+
+// Whole pixels, the common case
+template<class Out>
+void make_line(Point2D p0, Point2D p1, Out &pixels){
+	make_line(to_coord<Int32Coords>(p0), to_coord<Int32Coords>(p1), pixels);
+}
+
+// make_line with the textbook branch instead of the branchless update.
+// Kept as a reference for the benchmark; output is identical.
+void make_line_branchy(Point2D p0, Point2D p1, vector<Point2D> &pixels){
 	GLint dx = abs(p1.x - p0.x);
 	GLint dy = abs(p1.y - p0.y);
-	
-	// Avoid branching in the loop
-	void(*draw_pixel)(GLint x, GLint y, vector<Point2D> &pixels) = set_pixel; 
-	
-	// If slope is steeper than 1 or -1 ...
+	void(*draw_pixel)(GLint x, GLint y, vector<Point2D> &pixels) = set_pixel;
 	if(dy > dx){
-		// ... then we'll increment from y0 to y1 instead
-		// of x0 to x1
 		swap(dx, dy);
 		swap(p0.x, p0.y);
 		swap(p1.x, p1.y);
 		draw_pixel = swap_set_pixel;
 	}
-	// Go from "small" x to "large" x
 	if(p0.x > p1.x){
 		swap(p0.x, p1.x);
 		swap(p0.y, p1.y);
 	}
-
-	// Might be sloping up or down
 	GLint step_y = p0.y > p1.y ? -1 : 1;
-
-	// Initial x and y
 	GLint x = p0.x, y = p0.y;
-
 	GLint d = 2 * dy - dx;
 	GLint dE = 2 * dy;
 	GLint dNE = 2 * (dy - dx);
-
 	draw_pixel(x, y, pixels);
 	while(x < p1.x){
-		/*if(d <= 0){
+		x += 1;
+		if(d <= 0){
 			d += dE;
 		}else{
 			d += dNE;
 			y += step_y;
-		}*/
-
-		// Branchless version
-		x += 1;
-		bool east = d <= 0;
-		bool northeast = !east;
-		// Go east or northeast
-		d += dE * east + dNE * northeast;
-		y += step_y * northeast;
-
+		}
 		draw_pixel(x, y, pixels);
 	}
 }
 
 // Exploit radial symmetry for circle drawing
-void circle_points(GLint cx, GLint cy, GLint x, GLint y, vector<Point2D> &pixels){
+template<class Out>
+void circle_points(GLint cx, GLint cy, GLint x, GLint y, Out &pixels){
 	set_pixel(cx + x, cy + y, pixels);
 	set_pixel(cx - x, cy + y, pixels);
 	set_pixel(cx + x, cy - y, pixels);
@@ -85,7 +280,9 @@ void circle_points(GLint cx, GLint cy, GLint x, GLint y, vector<Point2D> &pixels
 }
 
 // Midpoint circle algorithm. Pretty much verbatim from textbook
-void make_circle(Point2D center, GLint radius, vector<Point2D> &pixels){
+template<class Out>
+void make_circle(Point2D center, GLint radius, Out &pixels){
+	reserve_pixels(circle_size(radius), pixels);
 	GLint x = 0;
 	GLint y = radius;
 	GLint d = 1 - radius;
@@ -118,40 +315,778 @@ void make_circle(Point2D center, GLint radius, vector<Point2D> &pixels){
 	}
 }
 
+// make_circle with the textbook branch. Benchmark reference only.
+void make_circle_branchy(Point2D center, GLint radius, vector<Point2D> &pixels){
+	GLint x = 0;
+	GLint y = radius;
+	GLint d = 1 - radius;
+	GLint dE = 3;
+	GLint dSE = -2 * radius + 5;
+	circle_points(center.x, center.y, x, y, pixels);
+	while(y > x){
+		if(d < 0){
+			d += dE;
+			dE += 2;
+			dSE += 2;
+		}else{
+			d += dSE;
+			dE += 2;
+			dSE += 4;
+			y -= 1;
+		}
+		x += 1;
+		circle_points(center.x, center.y, x, y, pixels);
+	}
+}
+
+// Rounded to the nearest 1/256 pixel, rather than truncated to a whole
+// one (which also pulled hands on the left and top in by a pixel)
+SubpixelPoint hand_end(Point2D center, GLint radius, GLfloat hand_cos, GLfloat hand_sin){
+	return SubpixelPoint(to_coord<Fixed24_8Coords>(center.x + (double)radius * hand_cos),
+		to_coord<Fixed24_8Coords>(center.y + (double)radius * hand_sin));
+}
+
 // Clock hands need to be updated each frame. The TimeAngle is calculated once per frame to
 // get the normalized endpoints for each hand. Just mix the radius in and create the lines.
-void make_hands(Point2D center, GLint radius, vector<Point2D> &pixels, TimeAngle &ta){
-	 Point2D hourHand(center.x + radius * ta.hour_cos, center.y + radius * ta.hour_sin);
-	 Point2D minHand(center.x + radius * ta.min_cos, center.y + radius * ta.min_sin);
-	 Point2D secHand(center.x + radius * ta.sec_cos, center.y + radius * ta.sec_sin);
-	 make_line(center, hourHand, pixels);
-	 make_line(center, minHand, pixels);
-	 make_line(center, secHand, pixels);
+template<class Out>
+void make_hands(Point2D center, GLint radius, Out &pixels, TimeAngle &ta){
+	 reserve_pixels(hands_size(center, radius, ta), pixels);
+	 SubpixelPoint from = to_coord<Fixed24_8Coords>(center);
+	 make_line(from, hand_end(center, radius, ta.hour_cos, ta.hour_sin), pixels);
+	 make_line(from, hand_end(center, radius, ta.min_cos, ta.min_sin), pixels);
+	 make_line(from, hand_end(center, radius, ta.sec_cos, ta.sec_sin), pixels);
 }
 
-// Calculate lines for bezier curve and add to pixel vector
+// Curve flattening works in floating point so subdivided control points
+// don't drift from rounding
+struct PointF{
+	double x;
+	double y;
+};
+
+// Is every interior control point within flatness of the chord? The
+// curve stays inside the hull of its control points, so if they're all
+// that close, so is the curve.
+static bool is_flat(const PointF *cp, size_t n, double flatness){
+	const PointF &a = cp[0];
+	const PointF &b = cp[n - 1];
+	double dx = b.x - a.x;
+	double dy = b.y - a.y;
+	double length2 = dx * dx + dy * dy;
+	for(size_t i = 1; i + 1 < n; ++i){
+		double px = cp[i].x - a.x;
+		double py = cp[i].y - a.y;
+		double dist2;
+		if(length2 == 0.0){
+			dist2 = px * px + py * py;
+		}else{
+			double cross = px * dy - py * dx;
+			dist2 = cross * cross / length2;
+		}
+		if(dist2 > flatness * flatness){
+			return false;
+		}
+	}
+	return true;
+}
+
+// Polyline points, rounded to whole pixels or kept to 1/256 of one
+static inline void push_point(double x, double y, vector<Point2D> &polyline){
+	polyline.push_back(Point2D((GLint)floor(x + 0.5), (GLint)floor(y + 0.5)));
+}
+static inline void push_point(double x, double y, vector<SubpixelPoint> &polyline){
+	polyline.push_back(SubpixelPoint(to_coord<Fixed24_8Coords>(x), to_coord<Fixed24_8Coords>(y)));
+}
+
+// Recursive de Casteljau subdivision at t = 0.5. Flat pieces contribute
+// their end point; MAX_CURVE_DEPTH bounds the work for degenerate input.
+// Each level splits into 2n points of scratch: the left half, and the
+// right half computed in place (the de Casteljau triangle only ever
+// reads entries below the one it's finishing).
+template<class P>
+static void subdivide(const PointF *cp, size_t n, double flatness, GLint depth, PointF *scratch, vector<P> &polyline){
+	if(depth == MAX_CURVE_DEPTH || is_flat(cp, n, flatness)){
+		push_point(cp[n - 1].x, cp[n - 1].y, polyline);
+		return;
+	}
+	PointF *left = scratch;
+	PointF *right = scratch + n;
+	for(size_t i = 0; i < n; ++i){
+		right[i] = cp[i];
+	}
+	for(size_t level = 0; level < n; ++level){
+		left[level] = right[0];
+		for(size_t i = 0; i + 1 < n - level; ++i){
+			right[i].x = 0.5 * (right[i].x + right[i + 1].x);
+			right[i].y = 0.5 * (right[i].y + right[i + 1].y);
+		}
+	}
+	subdivide(left, n, flatness, depth + 1, scratch + 2 * n, polyline);
+	subdivide(right, n, flatness, depth + 1, scratch + 2 * n, polyline);
+}
+
+// Adaptive flattening for a Bezier curve of any degree. Emits the start
+// point and then one point per flat piece, so small curves get a few
+// segments and large ones get as many as they need.
+template<class P>
+void flatten_curve(const Point2D *control_points, size_t count, GLfloat flatness, vector<P> &polyline){
+	if(!count){
+		return;
+	}
+	vector<PointF> scratch((2 * MAX_CURVE_DEPTH + 1) * count);
+	for(size_t i = 0; i < count; ++i){
+		scratch[i].x = control_points[i].x;
+		scratch[i].y = control_points[i].y;
+	}
+	push_point(control_points[0].x, control_points[0].y, polyline);
+	if(count > 1){
+		subdivide(&scratch[0], count, flatness, 0, &scratch[count], polyline);
+	}
+}
+
+// Fixed sampling for a Bezier curve of any degree. t comes from an
+// integer counter, so the last sample lands exactly on t = 1.
+template<class P>
+void sample_curve(const Point2D *control_points, size_t count, GLint segments, vector<P> &polyline){
+	vector<PointF> work(count);
+	for(GLint s = 0; s <= segments && count; ++s){
+		double t = (double)s / segments;
+		for(size_t i = 0; i < count; ++i){
+			work[i].x = control_points[i].x;
+			work[i].y = control_points[i].y;
+		}
+		for(size_t level = 1; level < count; ++level){
+			for(size_t i = 0; i + level < count; ++i){
+				work[i].x += t * (work[i + 1].x - work[i].x);
+				work[i].y += t * (work[i + 1].y - work[i].y);
+			}
+		}
+		push_point(work[0].x, work[0].y, polyline);
+	}
+}
+
+// Connect polyline vertices with midpoint lines. Flattening often yields
+// repeats once points are rounded, and those would only draw a pixel
+// that's already there.
+template<class P, class Out>
+void make_polyline(vector<P> &polyline, Out &pixels){
+	reserve_pixels(polyline_size(polyline), pixels);
+	if(polyline.size() == 1){
+		make_line(polyline[0], polyline[0], pixels);
+	}
+	for(size_t i = 1; i < polyline.size(); ++i){
+		if(polyline[i].x != polyline[i - 1].x || polyline[i].y != polyline[i - 1].y || i == 1){
+			make_line(polyline[i - 1], polyline[i], pixels);
+		}
+	}
+}
+
+// Bezier curve of degree control_points.size() - 1, flattened to within
+// CURVE_FLATNESS pixels. The polyline is kept to 1/256 pixel so its
+// pieces follow the curve between pixels instead of between rounded
+// points.
 // This is in the book, but I used this as well:
 // http://www.cs.helsinki.fi/group/goa/mallinnus/curves/curves.html
-void make_curve(vector<Point2D> &control_points, vector<Point2D> &pixels){
-	Point2D begin = control_points[0];
-	Point2D end;
-	for(float t = 0.025; t <= 1.0; t += 0.025){
-		float _t = 1 - t;
-		float f1t = _t * _t * _t;
-		float f2t = 3.0 * t * _t * _t;
-		float f3t = 3.0 * t * t * _t;
-		float f4t = t * t * t;
-		end.x = 
-			control_points[0].x * f1t +
-			control_points[1].x * f2t +
-			control_points[2].x * f3t +
-			control_points[3].x * f4t;
-		end.y = 
-			control_points[0].y * f1t +
-			control_points[1].y * f2t +
-			control_points[2].y * f3t +
-			control_points[3].y * f4t;
-		make_line(begin, end, pixels);
-		begin = end;
+template<class Out>
+void make_curve(vector<Point2D> &control_points, Out &pixels){
+	vector<SubpixelPoint> polyline;
+	if(control_points.size()){
+		flatten_curve(&control_points[0], control_points.size(), CURVE_FLATNESS, polyline);
+	}
+	make_polyline(polyline, pixels);
+}
+
+// Bezier curve sampled at a fixed number of segments
+template<class Out>
+void make_curve_uniform(vector<Point2D> &control_points, GLint segments, Out &pixels){
+	vector<SubpixelPoint> polyline;
+	if(control_points.size()){
+		sample_curve(&control_points[0], control_points.size(), segments, polyline);
+	}
+	make_polyline(polyline, pixels);
+}
+
+// Piecewise Bezier path: consecutive curves of the given degree, each
+// starting on the last point of the one before it. Left over points
+// that don't make a whole segment are ignored.
+static void flatten_path(vector<Point2D> &control_points, GLint degree, vector<SubpixelPoint> &polyline){
+	for(size_t i = 0; degree > 0 && i + degree < control_points.size(); i += degree){
+		if(!polyline.empty()){
+			polyline.pop_back();
+		}
+		flatten_curve(&control_points[i], degree + 1, CURVE_FLATNESS, polyline);
 	}
 }
+
+template<class Out>
+void make_path(vector<Point2D> &control_points, GLint degree, Out &pixels){
+	vector<SubpixelPoint> polyline;
+	flatten_path(control_points, degree, polyline);
+	make_polyline(polyline, pixels);
+}
+
+// Write span to span vector
+void set_span(int y, int x0, int x1, vector<Span> &spans){
+	spans.push_back(Span(y, x0, x1, false));
+}
+
+// Write span to span vector swapping x and y, which makes it vertical
+void swap_set_span(int y, int x0, int x1, vector<Span> &spans){
+	spans.push_back(Span(y, x0, x1, true));
+}
+
+// Same walk as make_line, but only emit when y steps. Steep lines are
+// swapped just like make_line, so their runs come out vertical.
+template<class C>
+void make_line_spans(CoordPoint<C> p0, CoordPoint<C> p1, vector<Span> &spans){
+	typedef typename C::Wide Wide;
+	LineWalk<C> walk(p0, p1);
+	reserve_more(line_spans_size(p0, p1), spans);
+
+	void(*draw_span)(GLint y, GLint x0, GLint x1, vector<Span> &spans) = set_span;
+	if(walk.steep){
+		draw_span = swap_set_span;
+	}
+
+	Wide x = walk.x, y = walk.y;
+	Wide run = x;
+	Wide d = walk.d;
+	while(x < walk.end){
+		x += 1;
+		if(d <= 0){
+			d += walk.dE;
+		}else{
+			// Row changes, so the current run ends before x
+			d += walk.dNE;
+			draw_span((GLint)y, (GLint)run, (GLint)(x - 1), spans);
+			run = x;
+			y += walk.step_y;
+		}
+	}
+	draw_span((GLint)y, (GLint)run, (GLint)x, spans);
+}
+
+void make_line_spans(Point2D p0, Point2D p1, vector<Span> &spans){
+	make_line_spans(to_coord<Int32Coords>(p0), to_coord<Int32Coords>(p1), spans);
+}
+
+// Runs from x0 to x1 at height y in the first octant, reflected into all
+// eight. Octants near the top and bottom give horizontal runs; octants
+// near the sides give vertical ones. A run starting at x = 0 meets its
+// mirror image, so those are merged into one span.
+void circle_spans(GLint cx, GLint cy, GLint x0, GLint x1, GLint y, vector<Span> &spans){
+	if(x0 == 0){
+		set_span(cy + y, cx - x1, cx + x1, spans);
+		set_span(cy - y, cx - x1, cx + x1, spans);
+		swap_set_span(cx + y, cy - x1, cy + x1, spans);
+		swap_set_span(cx - y, cy - x1, cy + x1, spans);
+	}else{
+		set_span(cy + y, cx + x0, cx + x1, spans);
+		set_span(cy + y, cx - x1, cx - x0, spans);
+		set_span(cy - y, cx + x0, cx + x1, spans);
+		set_span(cy - y, cx - x1, cx - x0, spans);
+		swap_set_span(cx + y, cy + x0, cy + x1, spans);
+		swap_set_span(cx + y, cy - x1, cy - x0, spans);
+		swap_set_span(cx - y, cy + x0, cy + x1, spans);
+		swap_set_span(cx - y, cy - x1, cy - x0, spans);
+	}
+}
+
+// Same walk as make_circle, emitting a run every time y steps
+void make_circle_spans(Point2D center, GLint radius, vector<Span> &spans){
+	reserve_more(circle_spans_size(radius), spans);
+	GLint x = 0;
+	GLint y = radius;
+	GLint d = 1 - radius;
+	GLint dE = 3;
+	GLint dSE = -2 * radius + 5;
+	GLint run = 0;
+	while(y > x){
+		x += 1;
+		if(d < 0){
+			d += dE;
+			dE += 2;
+			dSE += 2;
+		}else{
+			d += dSE;
+			dE += 2;
+			dSE += 4;
+			circle_spans(center.x, center.y, run, x - 1, y, spans);
+			run = x;
+			y -= 1;
+		}
+	}
+	circle_spans(center.x, center.y, run, x, y, spans);
+}
+
+// Widen the disc rows k either side of the center to reach half pixels
+// either side of it
+static void disc_rows(Span *rows, GLint cx, GLint k, GLint half){
+	for(int side = 0; side < 2; ++side){
+		Span &row = side ? rows[-k] : rows[k];
+		row.x0 = cx - half < row.x0 ? cx - half : row.x0;
+		row.x1 = cx + half > row.x1 ? cx + half : row.x1;
+	}
+}
+
+// Same walk as make_circle. Each pixel of the first octant widens the
+// rows it's reflected onto, so every row ends at the circle's outermost
+// pixel on it.
+void make_disc_spans(Point2D center, GLint radius, vector<Span> &spans){
+	size_t top = spans.size();
+	spans.resize(top + 2 * radius + 1);
+	Span *rows = &spans[top] + radius;
+	for(GLint k = -radius; k <= radius; ++k){
+		rows[k] = Span(center.y + k, center.x, center.x - 1, false);
+	}
+	GLint x = 0;
+	GLint y = radius;
+	GLint d = 1 - radius;
+	GLint dE = 3;
+	GLint dSE = -2 * radius + 5;
+	disc_rows(rows, center.x, y, x);
+	disc_rows(rows, center.x, x, y);
+	while(y > x){
+		x += 1;
+		if(d < 0){
+			d += dE;
+			dE += 2;
+			dSE += 2;
+		}else{
+			d += dSE;
+			dE += 2;
+			dSE += 4;
+			y -= 1;
+		}
+		disc_rows(rows, center.x, y, x);
+		disc_rows(rows, center.x, x, y);
+	}
+}
+
+// Polygon edges are walked down the rows in pixels << FILL_FRACTION_BITS,
+// which keeps them to well under a pixel over any length that fits
+static const int FILL_FRACTION_BITS = 24;
+
+// One polygon edge, from the first row whose center is on or below its
+// top end to the last one above its bottom end
+struct FillEdge{
+	GLint top;			// First row
+	GLint bottom;		// Row after the last
+	long long x;		// Where it crosses the current row, rounded down
+	long long step;		// x per row, rounded down
+	long long error;	// What x was rounded down by, in 1/dy
+	long long lost;		// What step was rounded down by, in 1/dy
+	long long dy;
+	GLint winding;		// 1 going down the rows, -1 going up
+};
+
+// n / d and n % d rounded down, for d > 0
+static void floor_divide(long long n, long long d, long long &quotient, long long &remainder){
+	quotient = n / d;
+	remainder = n % d;
+	if(remainder < 0){
+		quotient -= 1;
+		remainder += d;
+	}
+}
+
+static bool edge_above(const FillEdge &a, const FillEdge &b){
+	return a.top < b.top;
+}
+
+// The pixels whose centers are from left up to right
+static void fill_run(GLint y, long long left, long long right, vector<Span> &spans){
+	const long long below_one = (1LL << FILL_FRACTION_BITS) - 1;
+	GLint x0 = (GLint)((left + below_one) >> FILL_FRACTION_BITS);
+	GLint x1 = (GLint)((right + below_one) >> FILL_FRACTION_BITS) - 1;
+	if(x0 <= x1){
+		spans.push_back(Span(y, x0, x1, false));
+	}
+}
+
+// Scanline fill with an active edge table. Edges are sorted by their
+// first row and join the active list there; every row, the active edges
+// are put in order of where they cross it, and the rule says which gaps
+// between crossings are inside. Crossings hardly ever change order from
+// one row to the next, so an insertion sort is all that takes. Rows
+// nothing crosses are skipped. Crossings are stepped exactly, like the
+// decision variable of a line, so an edge through a pixel center always
+// has the same pixel on its inside, and polygons that share an edge
+// neither overlap nor leave a gap.
+void make_polygon_spans(const vector<SubpixelPoint> &polygon, FillRule rule, vector<Span> &spans){
+	typedef long long Wide;
+	const int shift = FILL_FRACTION_BITS - Fixed24_8Coords::FRACTION_BITS;
+	const Wide one = 1 << Fixed24_8Coords::FRACTION_BITS;
+	vector<FillEdge> edges;
+	edges.reserve(polygon.size());
+	for(size_t i = 0; i < polygon.size(); ++i){
+		SubpixelPoint a = polygon[i];
+		SubpixelPoint b = polygon[i + 1 < polygon.size() ? i + 1 : 0];
+		FillEdge edge;
+		edge.winding = 1;
+		if(a.y > b.y){
+			swap(a, b);
+			edge.winding = -1;
+		}
+		edge.top = (GLint)(((Wide)a.y + one - 1) >> Fixed24_8Coords::FRACTION_BITS);
+		edge.bottom = (GLint)(((Wide)b.y + one - 1) >> Fixed24_8Coords::FRACTION_BITS);
+		if(edge.top >= edge.bottom){
+			continue;
+		}
+		Wide dx = (Wide)b.x - a.x;
+		edge.dy = (Wide)b.y - a.y;
+		floor_divide(dx << FILL_FRACTION_BITS, edge.dy, edge.step, edge.lost);
+		floor_divide(((Wide)edge.top * one - a.y) * (dx << shift), edge.dy, edge.x, edge.error);
+		edge.x += (Wide)a.x << shift;
+		edges.push_back(edge);
+	}
+	sort(edges.begin(), edges.end(), edge_above);
+
+	vector<FillEdge> active;
+	size_t next = 0;
+	GLint y = 0;
+	while(next < edges.size() || !active.empty()){
+		if(active.empty()){
+			y = edges[next].top;
+		}
+		size_t kept = 0;
+		for(size_t i = 0; i < active.size(); ++i){
+			if(active[i].bottom > y){
+				active[kept++] = active[i];
+			}
+		}
+		active.resize(kept);
+		for(; next < edges.size() && edges[next].top == y; ++next){
+			active.push_back(edges[next]);
+		}
+		for(size_t i = 1; i < active.size(); ++i){
+			FillEdge edge = active[i];
+			size_t j = i;
+			for(; j > 0 && active[j - 1].x > edge.x; --j){
+				active[j] = active[j - 1];
+			}
+			active[j] = edge;
+		}
+
+		GLint winding = 0;
+		Wide left = 0;
+		for(size_t i = 0; i < active.size(); ++i){
+			bool was_inside = rule == FILL_EVEN_ODD ? (winding & 1) != 0 : winding != 0;
+			winding += rule == FILL_EVEN_ODD ? 1 : active[i].winding;
+			bool inside = rule == FILL_EVEN_ODD ? (winding & 1) != 0 : winding != 0;
+			if(inside && !was_inside){
+				left = active[i].x;
+			}else if(was_inside && !inside){
+				fill_run(y, left, active[i].x, spans);
+			}
+		}
+		for(size_t i = 0; i < active.size(); ++i){
+			FillEdge &edge = active[i];
+			edge.x += edge.step;
+			edge.error += edge.lost;
+			if(edge.error >= edge.dy){
+				edge.error -= edge.dy;
+				edge.x += 1;
+			}
+		}
+		y += 1;
+	}
+}
+
+void make_closed_path_spans(vector<Point2D> &control_points, GLint degree, FillRule rule, vector<Span> &spans){
+	vector<SubpixelPoint> polygon;
+	flatten_path(control_points, degree, polygon);
+	make_polygon_spans(polygon, rule, spans);
+}
+
+// Anti-aliased line positions are kept in pixels << AA_FRACTION_BITS, so
+// a line's slope is exact to well under a pixel over its whole length
+static const int AA_FRACTION_BITS = 24;
+
+// Writes coverage straight into room made on the end of a CoverageSpans
+// up front, like VertexWriter does for vertices, so the kernels' inner
+// loops are plain stores. finish gives back whatever wasn't used.
+struct CoverageWriter{
+	CoverageSpans &runs;
+	unsigned char *bytes;	// All of runs.coverage
+	GLuint next;			// Next free byte
+
+	CoverageWriter(CoverageSpans &r, size_t most): runs(r), bytes(0), next((GLuint)r.coverage.size()) {
+		reserve_more(most, r.coverage);
+		r.coverage.resize(next + most);
+		bytes = &r.coverage[0];
+	}
+
+	void finish(void){
+		runs.coverage.resize(next);
+	}
+
+	// Append count bytes starting at from, back to front. Returns where
+	// they start.
+	GLuint reverse(GLuint from, GLint count){
+		GLuint first = next;
+		for(GLint i = 0; i < count; ++i){
+			bytes[next + i] = bytes[from + count - 1 - i];
+		}
+		next += count;
+		return first;
+	}
+};
+
+// Wu's line. The line is walked one column at a time along the major
+// axis, over the same columns as make_line, and each column covers the
+// two pixels the line passes between in proportion to how near it
+// passes each. Columns on the same pair of rows make one run. End
+// columns are covered in full, as they are by make_line, and skip_start
+// leaves out the one at p0 so a polyline doesn't cover its joints twice.
+static void line_coverage(SubpixelPoint p0, SubpixelPoint p1, bool skip_start, CoverageSpans &runs){
+	typedef long long Wide;
+	const Wide one = 1 << Fixed24_8Coords::FRACTION_BITS;
+	Wide x0 = p0.x, y0 = p0.y, x1 = p1.x, y1 = p1.y;
+	Wide dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	Wide dy = y1 > y0 ? y1 - y0 : y0 - y1;
+	bool steep = dy > dx;
+	if(steep){
+		swap(dx, dy);
+		swap(x0, y0);
+		swap(x1, y1);
+	}
+	bool backward = x0 > x1;
+	if(backward){
+		swap(x0, x1);
+		swap(y0, y1);
+	}
+	Wide x = to_pixel<Fixed24_8Coords>(x0);
+	Wide end = to_pixel<Fixed24_8Coords>(x1);
+
+	// Rows move gradient per column, and start wherever the line crosses
+	// the first column's center
+	Wide gradient = dx ? (y1 - y0) * ((Wide)1 << AA_FRACTION_BITS) / dx : 0;
+	Wide y = y0 * ((Wide)1 << (AA_FRACTION_BITS - Fixed24_8Coords::FRACTION_BITS)) + (x * one - x0) * gradient / one;
+	if(skip_start){
+		if(backward){
+			end -= 1;
+		}else{
+			x += 1;
+			y += gradient;
+		}
+	}
+	if(x > end){
+		return;
+	}
+	reserve_more((size_t)(dy / one + 3), runs.spans);
+	CoverageWriter out(runs, (size_t)(end - x + 1));
+
+	// Bytes go through locals: stores through unsigned char can alias
+	// anything, so out's members would be loaded again for every one. The
+	// row past each run is left off when it would be all zero, as it is
+	// for lines that run along pixel centers.
+	Wide row = y >> AA_FRACTION_BITS;
+	Wide run = x;
+	unsigned char *bytes = out.bytes + out.next;
+	unsigned char *first = bytes;
+	unsigned char outer = 0;
+	for(; x <= end; ++x, y += gradient){
+		if(y >> AA_FRACTION_BITS != row){
+			runs.spans.push_back(CoverageSpan((GLint)row, (GLint)run, (GLint)(x - 1), steep, outer ? 1 : 0, (GLuint)(first - out.bytes)));
+			row = y >> AA_FRACTION_BITS;
+			run = x;
+			first = bytes;
+			outer = 0;
+		}
+		unsigned char f = (unsigned char)((y >> (AA_FRACTION_BITS - 8)) & 0xFF);
+		*bytes++ = 255 - f;
+		outer |= f;
+	}
+	runs.spans.push_back(CoverageSpan((GLint)row, (GLint)run, (GLint)end, steep, outer ? 1 : 0, (GLuint)(first - out.bytes)));
+	out.next = (GLuint)(bytes - out.bytes);
+	out.finish();
+}
+
+void make_line_aa(SubpixelPoint p0, SubpixelPoint p1, CoverageSpans &runs){
+	line_coverage(p0, p1, false, runs);
+}
+
+void make_line_aa(Point2D p0, Point2D p1, CoverageSpans &runs){
+	line_coverage(to_coord<Fixed24_8Coords>(p0), to_coord<Fixed24_8Coords>(p1), false, runs);
+}
+
+// One row's runs of a Wu circle, at height y in the first octant and
+// paired with the row outside it when outer is set, reflected into all
+// eight like circle_spans. Coverage for columns x0 through x1 is at
+// first. Column 0 and the diagonal are where octants meet, and those
+// pixels are only covered once.
+static void circle_coverage(GLint cx, GLint cy, GLint x0, GLint x1, GLint y, GLuint first, bool outer, CoverageWriter &out){
+	vector<CoverageSpan> &spans = out.runs.spans;
+	GLint pair = outer ? 1 : 0;
+	GLint mirror0 = x0 > 0 ? x0 : 1;
+	GLint side1 = x1 < y ? x1 : y - 1;
+	GLuint back = x1 >= mirror0 ? out.reverse(first + (mirror0 - x0), x1 - mirror0 + 1) : 0;
+	spans.push_back(CoverageSpan(cy + y, cx + x0, cx + x1, false, pair, first));
+	spans.push_back(CoverageSpan(cy - y, cx + x0, cx + x1, false, -pair, first));
+	if(x1 >= mirror0){
+		spans.push_back(CoverageSpan(cy + y, cx - x1, cx - mirror0, false, pair, back));
+		spans.push_back(CoverageSpan(cy - y, cx - x1, cx - mirror0, false, -pair, back));
+	}
+	if(side1 >= x0){
+		spans.push_back(CoverageSpan(cx + y, cy + x0, cy + side1, true, pair, first));
+		spans.push_back(CoverageSpan(cx - y, cy + x0, cy + side1, true, -pair, first));
+	}
+	if(side1 >= mirror0){
+		spans.push_back(CoverageSpan(cx + y, cy - side1, cy - mirror0, true, pair, back + (x1 - side1)));
+		spans.push_back(CoverageSpan(cx - y, cy - side1, cy - mirror0, true, -pair, back + (x1 - side1)));
+	}
+
+	// The pixel on the diagonal belongs to the first octant, but the one
+	// paired with it in the octants near the sides doesn't
+	if(side1 < x1 && outer){
+		GLuint single = out.next;
+		out.bytes[out.next++] = 255 - out.bytes[first + (x1 - x0)];
+		spans.push_back(CoverageSpan(cx + y + 1, cy + x1, cy + x1, true, 0, single));
+		spans.push_back(CoverageSpan(cx + y + 1, cy - x1, cy - x1, true, 0, single));
+		spans.push_back(CoverageSpan(cx - y - 1, cy + x1, cy + x1, true, 0, single));
+		spans.push_back(CoverageSpan(cx - y - 1, cy - x1, cy - x1, true, 0, single));
+	}
+}
+
+// Wu's circle: each column of the first octant covers the two rows the
+// circle passes between, like line_coverage, and runs are reflected
+// into the other seven octants.
+void make_circle_aa(Point2D center, GLint radius, CoverageSpans &runs){
+	if(radius < 1){
+		runs.spans.push_back(CoverageSpan(center.y, center.x, center.x, false, 0, (GLuint)runs.coverage.size()));
+		runs.coverage.push_back(255);
+		return;
+	}
+
+	// The first octant ends at the last column with 2x^2 <= r^2
+	double r2 = (double)radius * radius;
+	GLint last = (GLint)(radius * 0.70710678);
+	while(2.0 * (last + 1) * (last + 1) <= r2){
+		last += 1;
+	}
+	while(2.0 * last * last > r2){
+		last -= 1;
+	}
+	reserve_more(12 * (size_t)(last + 1) + 4, runs.spans);
+	CoverageWriter out(runs, 2 * (size_t)(last + 1) + 2);
+
+	GLint row = radius;
+	GLint run = 0;
+	GLuint first = out.next;
+	bool outer = false;
+	for(GLint x = 0; x <= last; ++x){
+		double y = sqrt(r2 - (double)x * x);
+		GLint whole = (GLint)y;
+		if(whole != row){
+			circle_coverage(center.x, center.y, run, x - 1, row, first, outer, out);
+			row = whole;
+			run = x;
+			first = out.next;
+			outer = false;
+		}
+		GLint f = (GLint)((y - whole) * 256.0);
+		unsigned char c = (unsigned char)(f > 255 ? 255 : f);
+		out.bytes[out.next++] = 255 - c;
+		outer = outer || c;
+	}
+	circle_coverage(center.x, center.y, run, last, row, first, outer, out);
+
+	// One column on, the circle has dropped below the diagonal but can
+	// still pass within a pixel of the next pixel on it, which neither
+	// octant reaches
+	GLint d = last + 1;
+	double y = sqrt(r2 - (double)d * d);
+	GLint f = (GLint)((y - floor(y)) * 256.0);
+	if((GLint)y + 1 == d && f > 0){
+		first = out.next;
+		out.bytes[out.next++] = (unsigned char)(f > 255 ? 255 : f);
+		runs.spans.push_back(CoverageSpan(center.y + d, center.x + d, center.x + d, false, 0, first));
+		runs.spans.push_back(CoverageSpan(center.y + d, center.x - d, center.x - d, false, 0, first));
+		runs.spans.push_back(CoverageSpan(center.y - d, center.x + d, center.x + d, false, 0, first));
+		runs.spans.push_back(CoverageSpan(center.y - d, center.x - d, center.x - d, false, 0, first));
+	}
+	out.finish();
+}
+
+// Pieces of the polyline after the first leave out their first column,
+// which the piece before them already covered
+void make_polyline_aa(vector<SubpixelPoint> &polyline, CoverageSpans &runs){
+	if(polyline.size() == 1){
+		line_coverage(polyline[0], polyline[0], false, runs);
+	}
+	for(size_t i = 1; i < polyline.size(); ++i){
+		if(polyline[i].x != polyline[i - 1].x || polyline[i].y != polyline[i - 1].y || i == 1){
+			line_coverage(polyline[i - 1], polyline[i], i > 1, runs);
+		}
+	}
+}
+
+// Flattened just like make_curve
+void make_curve_aa(vector<Point2D> &control_points, CoverageSpans &runs){
+	vector<SubpixelPoint> polyline;
+	if(control_points.size()){
+		flatten_curve(&control_points[0], control_points.size(), CURVE_FLATNESS, polyline);
+	}
+	make_polyline_aa(polyline, runs);
+}
+
+// Same end points as make_hands
+void make_hands_aa(Point2D center, GLint radius, CoverageSpans &runs, TimeAngle &ta){
+	SubpixelPoint from = to_coord<Fixed24_8Coords>(center);
+	line_coverage(from, hand_end(center, radius, ta.hour_cos, ta.hour_sin), false, runs);
+	line_coverage(from, hand_end(center, radius, ta.min_cos, ta.min_sin), false, runs);
+	line_coverage(from, hand_end(center, radius, ta.sec_cos, ta.sec_sin), false, runs);
+}
+
+// Instantiate the kernels for every pixel target
+template void make_line(Point2D p0, Point2D p1, vector<Point2D> &pixels);
+template void make_circle(Point2D center, GLint radius, vector<Point2D> &pixels);
+template void make_curve(vector<Point2D> &control_points, vector<Point2D> &pixels);
+template void make_curve_uniform(vector<Point2D> &control_points, GLint segments, vector<Point2D> &pixels);
+template void make_path(vector<Point2D> &control_points, GLint degree, vector<Point2D> &pixels);
+template void make_hands(Point2D center, GLint radius, vector<Point2D> &pixels, TimeAngle &ta);
+
+template void make_line(Point2D p0, Point2D p1, VertexWriter &pixels);
+template void make_circle(Point2D center, GLint radius, VertexWriter &pixels);
+template void make_curve(vector<Point2D> &control_points, VertexWriter &pixels);
+template void make_curve_uniform(vector<Point2D> &control_points, GLint segments, VertexWriter &pixels);
+template void make_path(vector<Point2D> &control_points, GLint degree, VertexWriter &pixels);
+template void make_polyline(vector<Point2D> &polyline, VertexWriter &pixels);
+template void make_polyline(vector<SubpixelPoint> &polyline, VertexWriter &pixels);
+template void make_hands(Point2D center, GLint radius, VertexWriter &pixels, TimeAngle &ta);
+
+template void make_line(Point2D p0, Point2D p1, Raster &pixels);
+template void make_circle(Point2D center, GLint radius, Raster &pixels);
+template void make_curve(vector<Point2D> &control_points, Raster &pixels);
+template void make_curve_uniform(vector<Point2D> &control_points, GLint segments, Raster &pixels);
+template void make_path(vector<Point2D> &control_points, GLint degree, Raster &pixels);
+template void make_hands(Point2D center, GLint radius, Raster &pixels, TimeAngle &ta);
+
+// Polylines in whole pixels and in fixed point
+template size_t polyline_size(vector<Point2D> &polyline);
+template size_t polyline_size(vector<SubpixelPoint> &polyline);
+template void flatten_curve(const Point2D *control_points, size_t count, GLfloat flatness, vector<Point2D> &polyline);
+template void flatten_curve(const Point2D *control_points, size_t count, GLfloat flatness, vector<SubpixelPoint> &polyline);
+template void sample_curve(const Point2D *control_points, size_t count, GLint segments, vector<Point2D> &polyline);
+template void sample_curve(const Point2D *control_points, size_t count, GLint segments, vector<SubpixelPoint> &polyline);
+
+// Lines in every coordinate system
+template size_t line_size(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1);
+template size_t line_size(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1);
+template size_t line_size(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1);
+template size_t line_spans_size(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1);
+template size_t line_spans_size(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1);
+template size_t line_spans_size(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1);
+template void make_line_spans(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1, vector<Span> &spans);
+template void make_line_spans(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1, vector<Span> &spans);
+template void make_line_spans(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1, vector<Span> &spans);
+template void make_line(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1, vector<Point2D> &pixels);
+template void make_line(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1, vector<Point2D> &pixels);
+template void make_line(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1, vector<Point2D> &pixels);
+template void make_line(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1, VertexWriter &pixels);
+template void make_line(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1, VertexWriter &pixels);
+template void make_line(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1, VertexWriter &pixels);
+template void make_line(CoordPoint<Int32Coords> p0, CoordPoint<Int32Coords> p1, Raster &pixels);
+template void make_line(CoordPoint<Int64Coords> p0, CoordPoint<Int64Coords> p1, Raster &pixels);
+template void make_line(CoordPoint<Fixed24_8Coords> p0, CoordPoint<Fixed24_8Coords> p1, Raster &pixels);
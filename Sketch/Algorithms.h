@@ -6,22 +6,149 @@
 using namespace std;
 
 #include "Globals.h"
+#include "Raster.h"
+#include "Coord.h"
+#include "Coverage.h"
+
+// The make_* functions write to any pixel target with a set_pixel and
+// swap_set_pixel overload. Algorithms.cpp instantiates them for
+// vector<Point2D>, VertexWriter (straight into VertexBuffer or Layer
+// storage) and Raster (for headless rendering).
+//
+// Lines can also be walked in any of the coordinate systems in Coord.h.
+// The Point2D versions are the Int32Coords ones; clock hands and curves
+// use fixed point end points so they aren't rounded before they're drawn.
 
 // Write single pixel vector
 void set_pixel(int x, int y, vector<Point2D> &pixels);
 void swap_set_pixel(int x, int y, vector<Point2D> &pixels);
+
+// Write single pixel straight to a CPU framebuffer
+void set_pixel(int x, int y, Raster &pixels);
+void swap_set_pixel(int x, int y, Raster &pixels);
+
+// Write single pixel straight to vertex storage
+void set_pixel(int x, int y, VertexWriter &pixels);
+void swap_set_pixel(int x, int y, VertexWriter &pixels);
+
+// Make room for n more pixels. Only vectors need it; the other targets
+// are sized up front or don't store pixels at all.
+void reserve_pixels(size_t n, vector<Point2D> &pixels);
+inline void reserve_pixels(size_t, Raster &) {}
+inline void reserve_pixels(size_t, VertexWriter &) {}
+
+// Pixel counts, for sizing storage before drawing. Lines, polylines and
+// hands are exact (hands are three lines); circles are upper bounds.
+size_t line_size(Point2D p0, Point2D p1);
+template<class C>
+size_t line_size(CoordPoint<C> p0, CoordPoint<C> p1);
+size_t circle_size(GLint radius);
+template<class P>
+size_t polyline_size(vector<P> &polyline);
+size_t hands_size(Point2D center, GLint radius, TimeAngle &ta);
+
+// Span counts, upper bounds
+size_t line_spans_size(Point2D p0, Point2D p1);
+template<class C>
+size_t line_spans_size(CoordPoint<C> p0, CoordPoint<C> p1);
+size_t circle_spans_size(GLint radius);
 	
 // Write line pixels to vector
-void make_line(Point2D p0, Point2D p1, vector<Point2D> &pixels);
+template<class Out>
+void make_line(Point2D p0, Point2D p1, Out &pixels);
+template<class C, class Out>
+void make_line(CoordPoint<C> p0, CoordPoint<C> p1, Out &pixels);
 
 // Write circle pixels to vector
-void circle_points(GLint cx, GLint cy, GLint x, GLint y, vector<Point2D> &pixels);
-void make_circle(Point2D center, GLint radius, vector<Point2D> &pixels);
+template<class Out>
+void circle_points(GLint cx, GLint cy, GLint x, GLint y, Out &pixels);
+template<class Out>
+void make_circle(Point2D center, GLint radius, Out &pixels);
+
+// Vectorized make_line and make_circle for pixel vectors (SSE2 when the
+// CPU has it). Same pixels in the same order as the scalar versions.
+void make_line_simd(Point2D p0, Point2D p1, vector<Point2D> &pixels);
+void make_circle_simd(Point2D center, GLint radius, vector<Point2D> &pixels);
+void make_line_simd(Point2D p0, Point2D p1, VertexWriter &pixels);
+void make_circle_simd(Point2D center, GLint radius, VertexWriter &pixels);
+
+// Textbook (branching) versions of make_line and make_circle, kept so the
+// benchmark can compare them against the branchless ones
+void make_line_branchy(Point2D p0, Point2D p1, vector<Point2D> &pixels);
+void make_circle_branchy(Point2D center, GLint radius, vector<Point2D> &pixels);
+
+// Flatten a Bezier curve of any degree into a polyline (appended), of
+// Point2D or SubpixelPoint
+template<class P>
+void flatten_curve(const Point2D *control_points, size_t count, GLfloat flatness, vector<P> &polyline);
+template<class P>
+void sample_curve(const Point2D *control_points, size_t count, GLint segments, vector<P> &polyline);
+
+// Write polyline pixels to vector
+template<class P, class Out>
+void make_polyline(vector<P> &polyline, Out &pixels);
+
+// Write curve pixels to vector. The degree is control_points.size() - 1.
+template<class Out>
+void make_curve(vector<Point2D> &control_points, Out &pixels);
+template<class Out>
+void make_curve_uniform(vector<Point2D> &control_points, GLint segments, Out &pixels);
 
-// Write curve pixels to vector
-void make_curve(vector<Point2D> &control_points, vector<Point2D> &pixels);
+// Write pixels for consecutive curves of one degree sharing end points
+template<class Out>
+void make_path(vector<Point2D> &control_points, GLint degree, Out &pixels);
+
+// Where a clock hand ends. Everything that draws hands uses this.
+SubpixelPoint hand_end(Point2D center, GLint radius, GLfloat hand_cos, GLfloat hand_sin);
 
 // Write clock hand pixels to vector
-void make_hands(Point2D center, GLint radius, vector<Point2D> &pixels, TimeAngle &ta);
+template<class Out>
+void make_hands(Point2D center, GLint radius, Out &pixels, TimeAngle &ta);
+
+// Span versions cover exactly the same pixels as make_line and make_circle,
+// but emit one Span per run instead of one Point2D per pixel.
+
+// Write single span to vector
+void set_span(int y, int x0, int x1, vector<Span> &spans);
+void swap_set_span(int y, int x0, int x1, vector<Span> &spans);
+
+// Write line runs to vector
+void make_line_spans(Point2D p0, Point2D p1, vector<Span> &spans);
+template<class C>
+void make_line_spans(CoordPoint<C> p0, CoordPoint<C> p1, vector<Span> &spans);
+
+// Write circle runs to vector
+void circle_spans(GLint cx, GLint cy, GLint x0, GLint x1, GLint y, vector<Span> &spans);
+void make_circle_spans(Point2D center, GLint radius, vector<Span> &spans);
+
+// Filled shapes, as horizontal runs. A disc is one run a row, top to
+// bottom, covering its circle's pixels and everything inside them.
+// Polygons are closed from their last point back to their first and
+// cover the pixels whose centers are inside by rule; paths (as in
+// make_path) are flattened into one. A single curve closed that way
+// never winds round anything twice, so the rules only differ for paths.
+void make_disc_spans(Point2D center, GLint radius, vector<Span> &spans);
+void make_polygon_spans(const vector<SubpixelPoint> &polygon, FillRule rule, vector<Span> &spans);
+void make_closed_path_spans(vector<Point2D> &control_points, GLint degree, FillRule rule, vector<Span> &spans);
+
+// Anti-aliased versions write coverage runs (see Coverage.h) instead of
+// hard pixels, for targets that can blend. Lines, curves and hands are
+// Wu's, walked over the same columns as make_line; circles cover the two
+// pixels either side of the true circle in each column. Lines and circles
+// cover each pixel once; a curve's pieces leave out the end they share.
+
+// Write anti-aliased line runs
+void make_line_aa(Point2D p0, Point2D p1, CoverageSpans &runs);
+void make_line_aa(SubpixelPoint p0, SubpixelPoint p1, CoverageSpans &runs);
+
+// Write anti-aliased circle runs
+void make_circle_aa(Point2D center, GLint radius, CoverageSpans &runs);
+
+// Write anti-aliased polyline and curve runs
+void make_polyline_aa(vector<SubpixelPoint> &polyline, CoverageSpans &runs);
+void make_curve_aa(vector<Point2D> &control_points, CoverageSpans &runs);
+
+// Write anti-aliased clock hand runs
+void make_hands_aa(Point2D center, GLint radius, CoverageSpans &runs, TimeAngle &ta);
 
 #endif ALGORITHMS_H
\ No newline at end of file
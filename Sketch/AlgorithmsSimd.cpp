@@ -0,0 +1,227 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Simd.h"
+
+// Vectorized make_line and make_circle. The midpoint loops are serial in
+// d, so these use closed forms for the same decisions instead, evaluate
+// several pixels per instruction with SSE2, and write straight into space
+// resized onto the end of the pixel vector (or a VertexWriter). The results match the scalar
+// kernels pixel for pixel and in the same order. Without SSE2 (checked at
+// runtime on x86, or on other architectures) the scalar kernels are used.
+
+// Closed form for make_line's decision variable: after j steps from p0 in
+// the first octant, the midpoint walk has stepped y
+//     k(j) = floor((2 * dy * j + dx - 1) / (2 * dx))
+// times, since it steps exactly when the line passes strictly above the
+// midpoint between the two candidate pixels.
+static inline GLint line_step(GLint j, GLint dx, GLint dy){
+	return (GLint)((2 * (long long)dy * j + dx - 1) / (2 * (long long)dx));
+}
+
+// Closed form for make_circle's test: the largest y with
+//     x^2 + (y - 1/2)^2 < r^2, i.e. (2y - 1)^2 < 4(r^2 - x^2)
+// The midpoint walk keeps y at column x exactly when y is no bigger than
+// this, and steps down one otherwise. sqrt gets within one, and integer
+// checks settle it.
+static inline GLint circle_limit(GLint x, GLint radius){
+	double s = 4.0 * ((double)radius * radius - (double)x * x);
+	GLint y = (GLint)floor((sqrt(s > 0.0 ? s : 0.0) + 1.0) / 2.0);
+	if((2.0 * y - 1.0) * (2.0 * y - 1.0) >= s){
+		y -= 1;
+	}
+	if((2.0 * y + 1.0) * (2.0 * y + 1.0) < s){
+		y += 1;
+	}
+	return y;
+}
+
+#ifdef SKETCH_SSE2
+
+// Longest run (2^25 pixels) the vector loop in make_line_sse2 can take
+// with 2 * dx * dx under 2^52
+const GLint SSE2_LINE_MAX_DX = 1 << 25;
+
+// Store two interleaved pixels, as ints for Point2D or floats for vertices
+static inline void store_pixels(GLint *out, __m128i xy){
+	_mm_storeu_si128((__m128i*)out, xy);
+}
+static inline void store_pixels(GLfloat *out, __m128i xy){
+	_mm_storeu_ps(out, _mm_cvtepi32_ps(xy));
+}
+
+// Line pixels four at a time: x is p0.x + j and y comes from line_step,
+// evaluated in double. Truncating the double quotient only matches the
+// integer division while the numerator, up to 2 * dx * dx, is below 2^52,
+// so longer lines take the scalar loop below. Writes line_size pixels
+// and returns the end of them.
+template<class T>
+static T *make_line_sse2(Point2D p0, Point2D p1, T *out){
+	GLint dx = abs(p1.x - p0.x);
+	GLint dy = abs(p1.y - p0.y);
+	bool swapped = dy > dx;
+	if(swapped){
+		swap(dx, dy);
+		swap(p0.x, p0.y);
+		swap(p1.x, p1.y);
+	}
+	if(p0.x > p1.x){
+		swap(p0.x, p1.x);
+		swap(p0.y, p1.y);
+	}
+	GLint step_y = p0.y > p1.y ? -1 : 1;
+	GLint count = dx + 1;
+
+	GLint j = 0;
+	if(dx > 0 && dx < SSE2_LINE_MAX_DX){
+		__m128d scale = _mm_set1_pd(2.0 * dy);
+		__m128d bias = _mm_set1_pd(dx - 1.0);
+		__m128d divisor = _mm_set1_pd(2.0 * dx);
+		__m128i neg = _mm_set1_epi32(step_y < 0 ? -1 : 0);
+		__m128i x0 = _mm_set1_epi32(p0.x);
+		__m128i y0 = _mm_set1_epi32(p0.y);
+		__m128i lanes = _mm_set_epi32(3, 2, 1, 0);
+		for(; j + 4 <= count; j += 4, out += 8){
+			__m128d j_lo = _mm_set_pd(j + 1.0, j + 0.0);
+			__m128d j_hi = _mm_set_pd(j + 3.0, j + 2.0);
+			__m128i k_lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_add_pd(_mm_mul_pd(j_lo, scale), bias), divisor));
+			__m128i k_hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_add_pd(_mm_mul_pd(j_hi, scale), bias), divisor));
+			__m128i k = _mm_unpacklo_epi64(k_lo, k_hi);
+
+			// y0 + step_y * k, with step_y = -1 done as two's complement
+			__m128i y = _mm_add_epi32(y0, _mm_sub_epi32(_mm_xor_si128(k, neg), neg));
+			__m128i x = _mm_add_epi32(x0, _mm_add_epi32(_mm_set1_epi32(j), lanes));
+
+			// set_pixel gives (x, y); swap_set_pixel gives (y, x)
+			__m128i px = swapped ? y : x;
+			__m128i py = swapped ? x : y;
+			store_pixels(out, _mm_unpacklo_epi32(px, py));
+			store_pixels(out + 4, _mm_unpackhi_epi32(px, py));
+		}
+	}
+	for(; j < count; ++j, out += 2){
+		GLint x = p0.x + j;
+		GLint y = p0.y + step_y * (dx > 0 ? line_step(j, dx, dy) : 0);
+		out[0] = (T)(swapped ? y : x);
+		out[1] = (T)(swapped ? x : y);
+	}
+	return out;
+}
+
+// Circle pixels in three passes. First the closed-form limits for every
+// column in the octant, two columns per instruction. Then a cheap serial
+// pass turns them into the walk's actual y values and finds where the
+// octant ends. Last, each column's eight reflections go out as four
+// vector stores, in circle_points order.
+
+// The first two passes: y for each column, returning the pixel count
+static size_t circle_columns_sse2(GLint radius, vector<GLint> &ys){
+	// The walk stops before x passes r / sqrt(2), so this is enough columns
+	GLint columns = (GLint)(radius * 0.70710678) + 3;
+	vector<GLint> limits(columns + 1);
+	__m128d r2 = _mm_set1_pd(4.0 * radius * radius);
+	__m128d one = _mm_set1_pd(1.0);
+	__m128d two = _mm_set1_pd(2.0);
+	__m128d zero = _mm_setzero_pd();
+	GLint x = 1;
+	for(; x + 2 <= columns; x += 2){
+		__m128d xs = _mm_set_pd(x + 1.0, x + 0.0);
+		__m128d s = _mm_max_pd(_mm_sub_pd(r2, _mm_mul_pd(_mm_mul_pd(xs, xs), _mm_set1_pd(4.0))), zero);
+		__m128d y = _mm_cvtepi32_pd(_mm_cvttpd_epi32(_mm_div_pd(_mm_add_pd(_mm_sqrt_pd(s), one), two)));
+		__m128d e = _mm_sub_pd(_mm_mul_pd(y, two), one);
+		y = _mm_sub_pd(y, _mm_and_pd(_mm_cmpge_pd(_mm_mul_pd(e, e), s), one));
+		e = _mm_add_pd(_mm_mul_pd(y, two), one);
+		y = _mm_add_pd(y, _mm_and_pd(_mm_cmplt_pd(_mm_mul_pd(e, e), s), one));
+		__m128i yi = _mm_cvttpd_epi32(y);
+		limits[x] = _mm_cvtsi128_si32(yi);
+		limits[x + 1] = _mm_cvtsi128_si32(_mm_srli_si128(yi, 4));
+	}
+	for(; x <= columns; ++x){
+		limits[x] = circle_limit(x, radius);
+	}
+
+	// Replay the walk's decisions: stay while the limit allows, otherwise
+	// step down one
+	ys.assign(1, radius);
+	GLint y = radius;
+	size_t count = 4 + (radius != 0 ? 4 : 0);
+	for(x = 0; y > x; ){
+		x += 1;
+		GLint limit = x <= columns ? limits[x] : circle_limit(x, radius);
+		y = limit >= y ? y : y - 1;
+		ys.push_back(y);
+		count += x != y ? 8 : 4;
+	}
+	return count;
+}
+
+// The last pass. Returns the end of what it wrote.
+template<class T>
+static T *circle_points_sse2(Point2D center, vector<GLint> &ys, T *out){
+	__m128i base = _mm_set_epi32(center.y, center.x, center.y, center.x);
+	for(GLint i = 0; i < (GLint)ys.size(); ++i){
+		GLint cy = ys[i];
+		store_pixels(out, _mm_add_epi32(base, _mm_set_epi32(cy, -i, cy, i)));
+		store_pixels(out + 4, _mm_add_epi32(base, _mm_set_epi32(-cy, -i, -cy, i)));
+		out += 8;
+		if(i != cy){
+			store_pixels(out, _mm_add_epi32(base, _mm_set_epi32(i, -cy, i, cy)));
+			store_pixels(out + 4, _mm_add_epi32(base, _mm_set_epi32(-i, -cy, -i, cy)));
+			out += 8;
+		}
+	}
+	return out;
+}
+
+#endif
+
+// Vectors are resized once and written in place
+void make_line_simd(Point2D p0, Point2D p1, vector<Point2D> &pixels){
+#ifdef SKETCH_SSE2
+	if(use_sse2()){
+		size_t first = pixels.size();
+		pixels.resize(first + line_size(p0, p1));
+		make_line_sse2(p0, p1, &pixels[first].x);
+		return;
+	}
+#endif
+	make_line(p0, p1, pixels);
+}
+
+void make_line_simd(Point2D p0, Point2D p1, VertexWriter &pixels){
+#ifdef SKETCH_SSE2
+	if(use_sse2()){
+		pixels.next = make_line_sse2(p0, p1, pixels.next);
+		return;
+	}
+#endif
+	make_line(p0, p1, pixels);
+}
+
+void make_circle_simd(Point2D center, GLint radius, vector<Point2D> &pixels){
+#ifdef SKETCH_SSE2
+	if(use_sse2()){
+		vector<GLint> ys;
+		size_t first = pixels.size();
+		pixels.resize(first + circle_columns_sse2(radius, ys));
+		circle_points_sse2(center, ys, &pixels[first].x);
+		return;
+	}
+#endif
+	make_circle(center, radius, pixels);
+}
+
+void make_circle_simd(Point2D center, GLint radius, VertexWriter &pixels){
+#ifdef SKETCH_SSE2
+	if(use_sse2()){
+		vector<GLint> ys;
+		circle_columns_sse2(radius, ys);
+		pixels.next = circle_points_sse2(center, ys, pixels.next);
+		return;
+	}
+#endif
+	make_circle(center, radius, pixels);
+}
@@ -0,0 +1,182 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Shape.h"
+#include "ClockHands.h"
+#include "Perf.h"
+
+ClockHands::ClockHands():
+	centers(),
+	radii(),
+	filled(),
+	hour_hands(),
+	min_hands(),
+	sec_hands(),
+	faces(),
+	built(false),
+	built_scale(1.0f)
+{
+}
+
+void ClockHands::push(Point2D center, GLint radius, bool fill){
+	centers.push_back(center);
+	radii.push_back(radius);
+	filled.push_back(fill);
+}
+
+// A clock whose hands haven't been built yet has nothing in the layers
+void ClockHands::pop(void){
+	if(centers.empty()){
+		return;
+	}
+	if(hour_hands.size() == centers.size()){
+		hour_hands.pop();
+	}
+	if(min_hands.size() == centers.size()){
+		min_hands.pop();
+	}
+	if(sec_hands.size() == centers.size()){
+		sec_hands.pop();
+	}
+	if(faces.size() == centers.size()){
+		faces.pop();
+	}
+	centers.pop_back();
+	radii.pop_back();
+	filled.pop_back();
+}
+
+// Layers can only change at the end, so every hand is built again on
+// the next update
+void ClockHands::insert(size_t i, Point2D center, GLint radius, bool fill){
+	centers.insert(centers.begin() + i, center);
+	radii.insert(radii.begin() + i, radius);
+	filled.insert(filled.begin() + i, fill);
+	clear_hands();
+}
+
+void ClockHands::erase(size_t i){
+	centers.erase(centers.begin() + i);
+	radii.erase(radii.begin() + i);
+	filled.erase(filled.begin() + i);
+	clear_hands();
+}
+
+void ClockHands::clear(void){
+	centers.clear();
+	radii.clear();
+	filled.clear();
+	clear_hands();
+}
+
+void ClockHands::swap(ClockHands &other){
+	centers.swap(other.centers);
+	radii.swap(other.radii);
+	filled.swap(other.filled);
+	clear_hands();
+	other.clear_hands();
+}
+
+void ClockHands::clear_hands(void){
+	hour_hands.clear();
+	min_hands.clear();
+	sec_hands.clear();
+	faces.clear();
+}
+
+size_t ClockHands::size(void) const{
+	return centers.size();
+}
+
+// Hands never leave their circle, so this is all a tick changes
+Rect ClockHands::bounds(void) const{
+	Rect area;
+	for(size_t i = 0; i < centers.size(); ++i){
+		GLint x = centers[i].x;
+		GLint y = centers[i].y;
+		area.unite(Rect(x - radii[i], y - radii[i], x + radii[i] + 1, y + radii[i] + 1));
+	}
+	return area;
+}
+
+// Same end points as make_hands, one kind of hand at a time. Only
+// clocks past the end of the layer are built, so new clocks don't cost
+// a rebuild of the old ones. Faces are scaled with scale_shape, so the
+// hands are too, to stay centered.
+void ClockHands::extend(Layer &hands, GLfloat hand_cos, GLfloat hand_sin){
+	vector<Span> spans;
+	if(perf_enabled){
+		perf_frame.hands_built += centers.size() - hands.size();
+	}
+	for(size_t i = hands.size(); i < centers.size(); ++i){
+		if(!filled[i]){
+			Shape face = scale_shape(Shape(SHAPE_CLOCK, &centers[i], 1, radii[i]), built_scale);
+			SubpixelPoint end = hand_end(face.points[0], face.radius, hand_cos, hand_sin);
+			make_line_spans(to_coord<Fixed24_8Coords>(face.points[0]), end, spans);
+		}
+		hands.push(spans);
+		spans.clear();
+	}
+}
+
+// The same spans exports and Batch draw, so the window matches them
+void ClockHands::extend_faces(TimeAngle &ta){
+	vector<Span> spans;
+	for(size_t i = faces.size(); i < centers.size(); ++i){
+		if(filled[i]){
+			shape_spans(scale_shape(Shape(SHAPE_CLOCK, &centers[i], 1, radii[i], true), built_scale), ta, spans);
+		}
+		faces.push(spans);
+		spans.clear();
+	}
+}
+
+// A moved hand is stale for every clock, so its layer starts over, and
+// so do the filled faces it's cut out of
+void ClockHands::update(TimeAngle &ta, GLfloat scale){
+	PerfTimer timer(PERF_HANDS);
+	if(scale != built_scale){
+		built = false;
+		built_scale = scale;
+	}
+	if(!built || hour_key[0] != ta.hour_cos || hour_key[1] != ta.hour_sin){
+		hour_hands.clear();
+		faces.clear();
+		hour_key[0] = ta.hour_cos;
+		hour_key[1] = ta.hour_sin;
+	}
+	if(!built || min_key[0] != ta.min_cos || min_key[1] != ta.min_sin){
+		min_hands.clear();
+		faces.clear();
+		min_key[0] = ta.min_cos;
+		min_key[1] = ta.min_sin;
+	}
+	if(!built || sec_key[0] != ta.sec_cos || sec_key[1] != ta.sec_sin){
+		sec_hands.clear();
+		faces.clear();
+		sec_key[0] = ta.sec_cos;
+		sec_key[1] = ta.sec_sin;
+	}
+	built = true;
+	extend(hour_hands, ta.hour_cos, ta.hour_sin);
+	extend(min_hands, ta.min_cos, ta.min_sin);
+	extend(sec_hands, ta.sec_cos, ta.sec_sin);
+	extend_faces(ta);
+}
+
+void ClockHands::draw(void){
+	faces.draw();
+	hour_hands.draw();
+	min_hands.draw();
+	sec_hands.draw();
+}
+
+void ClockHands::draw(Raster &raster){
+	faces.draw(raster);
+	hour_hands.draw(raster);
+	min_hands.draw(raster);
+	sec_hands.draw(raster);
+}
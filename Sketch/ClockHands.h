@@ -0,0 +1,86 @@
+#ifndef CLOCK_HANDS_H
+#define CLOCK_HANDS_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Raster.h"
+#include "Layer.h"
+
+// ClockHands keeps the hands of every saved clock. Each kind of hand is
+// cached in its own Layer and only rebuilt when its angle in the
+// TimeAngle changes: hour hands once an hour, minute hands once a minute,
+// and second hands once a tick, all clocks in one pass. Hands are built at
+// the same scale as the LOD tier the faces are drawn at. Filled faces
+// are kept here too, not in the ShapeStore, with their hands taken out of
+// the disc by shape_spans, so they're rebuilt whenever any hand moves.
+class ClockHands{
+public:
+	ClockHands();
+
+	// Add a clock. Its hands are built on the next update.
+	void push(Point2D center, GLint radius, bool filled = false);
+
+	// Remove the most recent clock
+	void pop(void);
+
+	// Put a clock back at i, or remove clock i, counting in the order
+	// they were pushed
+	void insert(size_t i, Point2D center, GLint radius, bool filled = false);
+	void erase(size_t i);
+
+	// Remove every clock
+	void clear(void);
+
+	// Trade clocks with another set. Hands are built again on the next
+	// update.
+	void swap(ClockHands &other);
+
+	// Number of clocks
+	size_t size(void) const;
+
+	// Screen area covered by every clock face
+	Rect bounds(void) const;
+
+	// Rebuild whatever hands ta has moved, or every hand if the scale has
+	// changed
+	void update(TimeAngle &ta, GLfloat scale = 1.0f);
+
+	// Draw with GL
+	void draw(void);
+
+	// Draw into a CPU framebuffer
+	void draw(Raster &raster);
+
+private:
+	// Build one kind of hand, from its unit endpoint, for every clock
+	// that doesn't have one yet. Filled clocks add an empty entry.
+	void extend(Layer &hands, GLfloat hand_cos, GLfloat hand_sin);
+
+	// Build the face of every clock that doesn't have one yet, empty
+	// unless the clock is filled
+	void extend_faces(TimeAngle &ta);
+
+	// Drop every built hand
+	void clear_hands(void);
+
+	vector<Point2D> centers;
+	vector<GLint> radii;
+	vector<bool> filled;
+
+	Layer hour_hands;
+	Layer min_hands;
+	Layer sec_hands;
+	Layer faces;				// Filled faces, hands cut out
+
+	// Angles and scale the cached hands were built for
+	bool built;
+	GLfloat built_scale;
+	GLfloat hour_key[2];
+	GLfloat min_key[2];
+	GLfloat sec_key[2];
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef COORD_H
+#define COORD_H
+
+#include <cmath>
+
+#include "Globals.h"
+
+// Coordinate systems the line kernels can be compiled for. A coordinate
+// is Value / 2^FRACTION_BITS pixels, and Wide holds the decision variable
+// and anything else that grows with a line's length. The choice is made
+// at compile time by instantiating the kernels, so whole pixels never
+// pay for fractions and nothing pays for floating point.
+
+// Whole pixels in GLint: everything saved, and the common path. The
+// decision variable is twice the line's extent, so it's kept in 64 bits.
+struct Int32Coords{
+	typedef GLint Value;
+	typedef long long Wide;
+	enum { FRACTION_BITS = 0 };
+};
+
+// Whole pixels in 64 bits, for virtual canvases bigger than GLint.
+// Coordinates have to stay within 2^59 so the decision variable fits.
+// Pixels are still handed to targets as ints, so whoever draws has to
+// have translated the part they want near the origin.
+struct Int64Coords{
+	typedef long long Value;
+	typedef long long Wide;
+	enum { FRACTION_BITS = 0 };
+};
+
+// 24.8 fixed point: end points to 1/256 of a pixel, for ones that come
+// out of floating point math (clock hands, flattened curves) and would
+// otherwise be rounded or truncated before the line is walked. Covers
+// 2^23 pixels either way.
+struct Fixed24_8Coords{
+	typedef GLint Value;
+	typedef long long Wide;
+	enum { FRACTION_BITS = 8 };
+};
+
+// A point in one of the above
+template<class C>
+struct CoordPoint{
+	typename C::Value x;
+	typename C::Value y;
+
+	// Constructors
+	CoordPoint(): x(0), y(0) {}
+	CoordPoint(typename C::Value xc, typename C::Value yc): x(xc), y(yc) {}
+};
+
+// Points between pixels
+typedef CoordPoint<Fixed24_8Coords> SubpixelPoint;
+
+// Nearest coordinate to a position in pixels
+template<class C>
+inline typename C::Value to_coord(double pixels){
+	return (typename C::Value)floor(pixels * (1 << C::FRACTION_BITS) + 0.5);
+}
+
+// A whole pixel
+template<class C>
+inline CoordPoint<C> to_coord(const Point2D &p){
+	return CoordPoint<C>((typename C::Value)p.x << C::FRACTION_BITS, (typename C::Value)p.y << C::FRACTION_BITS);
+}
+
+// The pixel a coordinate falls in, with halves going up. Relies on >>
+// being arithmetic for negative values, which it is on every compiler
+// Sketch builds with.
+template<class C>
+inline typename C::Wide to_pixel(typename C::Wide v){
+	return (v + ((1 << C::FRACTION_BITS) >> 1)) >> C::FRACTION_BITS;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+
+// A run of anti-aliased pixels, laid out like Span (vertical runs are
+// stored swapped). Every pixel has a coverage from 0, untouched, to 255,
+// fully inked, one byte each from coverage[first] in the CoverageSpans
+// the run belongs to. Wu's algorithms cover pixels in pairs, one either
+// side of the true line, whose coverage adds up to 255, so a run can
+// carry its neighbor too: when pair is 1 or -1, row y + pair gets 255
+// minus each byte, with no bytes of its own.
+struct CoverageSpan{
+	GLint y;
+	GLint x0;
+	GLint x1;
+	bool vertical;
+	signed char pair;
+	GLuint first;
+
+	// Constructors
+	CoverageSpan(): y(0), x0(0), x1(0), vertical(false), pair(0), first(0) {}
+	CoverageSpan(GLint yc, GLint x0c, GLint x1c, bool v, GLint p, GLuint f): y(yc), x0(x0c), x1(x1c), vertical(v), pair((signed char)p), first(f) {}
+};
+
+// What the anti-aliased kernels write: runs, and their coverage packed
+// end to end. That's 20 bytes a run and at most one a pixel, where a
+// vertex is 8 a pixel. Clearing keeps the storage, so one that's reused
+// stops allocating once it's grown to the biggest shape it's seen.
+struct CoverageSpans{
+	vector<CoverageSpan> spans;
+	vector<unsigned char> coverage;
+
+	void clear(void){
+		spans.clear();
+		coverage.clear();
+	}
+};
+
+#endif
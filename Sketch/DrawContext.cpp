@@ -2,12 +2,20 @@
 #define DRAW_FUNCTIONS_H
 
 #include <sstream>
+#include <iomanip>
+#include <cstdio>
 #include <ctime>
+#include <sys/timeb.h>
+#include <new>
 
 using namespace std;
 
 #include "DrawContext.h"
 #include "Algorithms.h"
+#include "Extensions.h"
+#include "TileRender.h"
+#include "SceneFile.h"
+#include "Perf.h"
 
 // Initialize single instance once. Allow static access
 DrawContext& DrawContext::get_instance(){
@@ -21,211 +29,318 @@ DrawContext::DrawContext():
 	draw_control_points(false),
 	drawing_curve(false),
 	pressing(false),
+	smooth_seconds(false),
+	dedup(false),
+	smooth_export(false),
+	fill(false),
+	show_stats(false),
+	trace(0),
+	notice(0),
+	last_frame(),
 	draw_state(LINE),
+	width(DEFAULT_WIDTH),
+	height(DEFAULT_HEIGHT),
+	tier(LOD_ONE),
+	origin(0, 0),
 	start(0, 0),
 	mouse(0, 0),
 	control_points(),
-	line_data(),
-	curve_data(),
-	circle_data(),
-	control_data(),
-	clock_data(),
-	clock_centers(),
-	clock_radii()
+	scheduler(),
+	last_dirty(),
+	store(),
+	clock_hands(),
+	journal(store, clock_hands),
+	pool(),
+	toggle_text(),
+	menu_text(),
+	status_text(),
+	stats_text(),
+	temporary_seen()
 {
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);	// Set background color to be black
 	glColor3fv(WHITE);						// Set the drawing color to be white
-	glMatrixMode(GL_PROJECTION);			// Set "camera shape"
-	glLoadIdentity();						// Clearing the viewing matrix
-	gluOrtho2D(0.0, WIDTH, 0.0, HEIGHT);	// Setting the world window
-}
-
-// Write contents of a stream to screen at (x, y)
-void DrawContext::write(ostringstream &os, GLfloat x, GLfloat y, float *color){	
-	string output = os.str();
-	glColor3fv(color);
-	glRasterPos2f(x, y);
-	for(GLint i = 0; i < (GLint)output.length(); ++i){
-		glutBitmapCharacter(GLUT_BITMAP_8_BY_13, output[i]);
-	}
+	set_projection();						// Setting the world window
+	load_extensions();						// Find buffer object support
+
+	// The help text is fixed, so it's laid out once
+	vector<string> toggle(TOGGLE, TOGGLE + TOGGLE_SIZE);
+	vector<string> menu(MENU, MENU + MENU_SIZE);
+	toggle_text.set(toggle, (GLfloat)MENU_POS.x, (GLfloat)MENU_POS.y, GREEN);
+	menu_text.set(menu, (GLfloat)MENU_POS.x, (GLfloat)(MENU_POS.y + 13 * TOGGLE_SIZE), GREEN);
+}
+
+// Window coordinates go straight through, so the kernels never flip y and
+// nothing has to be rebuilt when the size changes. The half pixel puts
+// integer vertices on pixel centers.
+void DrawContext::set_projection(void){
+	glViewport(0, 0, width, height);
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+	gluOrtho2D(0.0, width, height, 0.0);
+	glTranslatef(0.5f, 0.5f, 0.0f);
+	glMatrixMode(GL_MODELVIEW);
 }
 
-// Draw the menu, state, and mouse position
+// Draw the menu, state, and mouse position. The menu never changes, and
+// the status line is only laid out again when what it says changes.
 void DrawContext::draw_interface(void){
-	Point2D cursor(MENU_POS);
-	// Help toggle
-	for(size_t i = 0; i < TOGGLE_SIZE; ++i, cursor.y -= 13){
-		ostringstream toggle_stream;
-		toggle_stream << TOGGLE[i];
-		write(toggle_stream, cursor.x, cursor.y, (float*)GREEN);
-	}
-	// Help dropdown menu
+	toggle_text.draw();
 	if(draw_menu){
-		for(size_t i = 0; i < MENU_SIZE; ++i, cursor.y -= 13){
-			ostringstream stream;
-			stream << MENU[i];
-			write(stream, cursor.x, cursor.y, (float*)GREEN);
-		}
+		menu_text.draw();
 	}
-	// Current drawing state
-	ostringstream state_stream;
-	switch(draw_state){
-	case LINE:
-		state_stream << "[L";
-		break;
-	case CIRCLE:
-		state_stream << "[O";
-		break;
-	case CURVE:
-		state_stream << "[S";
-		break;
-	case CLOCK:
-		state_stream << "[C";
-		break;
-	default:
-		state_stream << "[?";
-		break;
+
+	// Current drawing state, and position of cursor in draw space
+	static const char STATE_KEYS[] = { 'L', 'O', 'S', 'C', '?' };
+	char status[128];
+	sprintf_s(status, sizeof(status), "[%c%s%s] at (%d, %d)%s%s", STATE_KEYS[draw_state], draw_control_points ? "P" : "", fill ? " fill" : "",
+		mouse.x, mouse.y, notice ? "  " : "", notice ? notice : "");
+	status_text.set(status, (GLfloat)MOUSE_POS.x, (GLfloat)(height - MOUSE_POS.y), GREEN);
+	status_text.draw();
+	if(show_stats){
+		draw_stats();
 	}
-	if(draw_control_points){
-		state_stream << "P]";
-	}else{
-		state_stream << "]";
+}
+
+// Where the last frame went, down the right hand side
+void DrawContext::draw_stats(void){
+	const FrameStats &f = last_frame;
+	ostringstream lines[11];
+	lines[0] << fixed << setprecision(2) << "frame    " << setw(8) << f.total * 1e3 << " ms";
+	lines[1] << fixed << setprecision(2) << "geometry " << setw(8) << f.phase[PERF_GEOMETRY] * 1e3 << " ms";
+	lines[2] << fixed << setprecision(2) << "upload   " << setw(8) << f.phase[PERF_UPLOAD] * 1e3 << " ms";
+	lines[3] << fixed << setprecision(2) << "draw     " << setw(8) << f.phase[PERF_DRAW] * 1e3 << " ms";
+	lines[4] << fixed << setprecision(2) << "hands    " << setw(8) << f.phase[PERF_HANDS] * 1e3 << " ms " << f.hands_built << " built";
+	lines[5] << "temporary " << setw(10) << f.vertices[PERF_TEMPORARY] << " v";
+	lines[6] << "shapes    " << setw(10) << f.vertices[PERF_SHAPES] << " v";
+	lines[7] << "controls  " << setw(10) << f.vertices[PERF_CONTROLS] << " v";
+	lines[8] << "hands     " << setw(10) << f.vertices[PERF_CLOCK_HANDS] << " v";
+	lines[9] << "new       " << setw(10) << f.allocations << " / " << f.allocated_bytes / 1024 << " KB";
+	lines[10] << "cache     " << setw(10) << f.cached_bytes / 1024 << " KB";
+	vector<string> text;
+	for(size_t i = 0; i < 11; ++i){
+		text.push_back(lines[i].str());
 	}
-	// Position of cursor in draw space
-	state_stream << " at (" << mouse.x << ", " << mouse.y << ")";
-	write(state_stream, MOUSE_POS.x, MOUSE_POS.y, (float*)GREEN);
+	stats_text.set(text, (GLfloat)(width - STATS_WIDTH), (GLfloat)MENU_POS.y, GREEN);
+	stats_text.draw();
+}
+
+// Measurements are only taken while something wants them
+void DrawContext::set_tracing(bool on){
+	if(on && !trace){
+		trace = perf_open_trace(TRACE_PATH);
+	}else if(!on && trace){
+		fclose(trace);
+		trace = 0;
+	}
+	perf_enabled = show_stats || trace;
 }
 
 // Is (x, y) inside the window bounds?
 bool DrawContext::in_window(int x, int y){
-	return x > 0 && x < WIDTH && y > 0 && y < HEIGHT;
+	return x > 0 && x < width && y > 0 && y < height;
+}
+
+// Window pixel to saved coordinates
+Point2D DrawContext::to_world(GLint x, GLint y){
+	GLfloat zoom = lod_scale(tier);
+	return Point2D((GLint)floor((x + origin.x) / zoom + 0.5f), (GLint)floor((y + origin.y) / zoom + 0.5f));
+}
+
+// Saved coordinates to the current tier, rounded the way scale_shape
+// rounds, so rubber-banding lands where the saved shape will
+Point2D DrawContext::to_view(const Point2D &p){
+	return Point2D(to_view(p.x), to_view(p.y));
+}
+
+GLint DrawContext::to_view(GLint length){
+	return (GLint)floor(length * lod_scale(tier) + 0.5f);
 }
 
-// Truncated distance between start and end
+// Saved area to window pixels, rounded outward
+Rect DrawContext::to_screen(const Rect &area){
+	if(area.empty()){
+		return area;
+	}
+	GLfloat zoom = lod_scale(tier);
+	return Rect((GLint)floor(area.x0 * zoom) - origin.x - 1, (GLint)floor(area.y0 * zoom) - origin.y - 1,
+		(GLint)ceil(area.x1 * zoom) - origin.x + 1, (GLint)ceil(area.y1 * zoom) - origin.y + 1);
+}
+
+// Window pixels to saved coordinates, with a pixel to spare for rounding
+Rect DrawContext::to_saved(const Rect &area){
+	if(area.empty()){
+		return area;
+	}
+	GLfloat zoom = lod_scale(tier);
+	return Rect((GLint)floor((origin.x + area.x0) / zoom) - 1, (GLint)floor((origin.y + area.y0) / zoom) - 1,
+		(GLint)ceil((origin.x + area.x1) / zoom) + 1, (GLint)ceil((origin.y + area.y1) / zoom) + 1);
+}
+
+
+// Move to another tier keeping the point under (x, y) where it is
+void DrawContext::zoom_to(size_t new_tier, GLint x, GLint y){
+	Point2D anchor = to_world(x, y);
+	tier = new_tier;
+	origin = to_view(anchor);
+	origin.x -= x;
+	origin.y -= y;
+	mouse = to_world(x, y);
+}
+
+// Truncated distance between start and end. The squares are taken in
+// double, since they outgrow GLint past 46341 pixels.
 GLint DrawContext::int_distance(Point2D &start, Point2D &end){
-	GLint dx = end.x - start.x;
-	GLint dy = end.y - start.y;
-	return (GLint)sqrt((double)(dx * dx + dy * dy));
+	double dx = (double)end.x - start.x;
+	double dy = (double)end.y - start.y;
+	return (GLint)sqrt(dx * dx + dy * dy);
 }
 
 // Draw saved lines, curves, circles, and shapes. Also, build
 // and draw temporary shapes (rubber-band lines and circles) and
 // clock hands.
-void DrawContext::draw_shapes(){
-	time_t t = time(NULL);			// Get time right now
-	TimeAngle ta(localtime(&t));	// Calculate trigonometric data for all clock hands
-	vector<Point2D> pixels;			// All temporary drawing goes here
+void DrawContext::draw_shapes(const Rect &area){
+	_timeb now;						// Get time right now
+	_ftime(&now);
+	TimeAngle ta(localtime(&now.time), smooth_seconds ? now.millitm : 0);
+	GLfloat zoom = lod_scale(tier);
+	bool building_curve = drawing_curve && control_points.size();
 	glColor3fv(WHITE);
+
+	// Everything below is drawn at the zoom's LOD tier, offset by the pan
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glTranslatef((GLfloat)-origin.x, (GLfloat)-origin.y, 0.0f);
+
+	// Rubber-banding is in saved coordinates too; scale it the same way
+	// as the shape it turns into
+	PerfTimer geometry(PERF_GEOMETRY);
+	Point2D from = to_view(start);
+	Point2D to = to_view(mouse);
+	GLint radius = to_view(int_distance(start, mouse));
+	vector<Point2D> corners;
+	for(size_t i = 0; i < control_points.size(); ++i){
+		corners.push_back(to_view(control_points[i]));
+	}
+
+	// Size the temporary pixels first so they go straight into the
+	// vertex buffer
+	size_t count = 0;
+	if(pressing){
+		switch(draw_state){
+		case LINE:
+			count += line_size(from, to);
+			break;
+		case CIRCLE:
+			count += circle_size(radius);
+			break;
+		case CLOCK:
+			count += circle_size(radius) + hands_size(from, radius, ta);
+			break;
+		default:
+			break;
+		}
+	}
+	if(building_curve){
+		for(size_t i = 1; i < corners.size(); ++i){
+			count += line_size(corners[i - 1], corners[i]);
+		}
+		count += line_size(corners.back(), to);
+	}
+	VertexBuffer temporary(count);
+	VertexWriter pixels = temporary.writer();	// All temporary drawing goes here
 	
-	// Write rubber-band UI to local pixels
+	// Write rubber-band UI to temporary pixels
 	if(pressing){
-		GLint radius;
 		switch(draw_state){
 		case LINE:
-			make_line(start, mouse, pixels);
+			make_line_simd(from, to, pixels);
 			break;
 		case CIRCLE:
-			make_circle(start, int_distance(start, mouse), pixels);
+			make_circle_simd(from, radius, pixels);
 			break;
 		case CLOCK:
-			radius = int_distance(start, mouse);
-			make_circle(start, radius, pixels);
-			make_hands(start, radius, pixels, ta);
+			make_circle_simd(from, radius, pixels);
+			make_hands(from, radius, pixels, ta);
 			break;
 		default:
 			break;
 		}
 	}
 	
-	// Write control points and lines to local pixels while building a curve
-	if(drawing_curve){
-		if(control_points.size()){
-			for(size_t i = 1; i < control_points.size(); ++i){
-				make_line(control_points[i - 1], control_points[i], pixels);
-			}
-			make_line(control_points.back(), mouse, pixels);
+	// Write control points and lines to temporary pixels while building a curve
+	if(building_curve){
+		for(size_t i = 1; i < corners.size(); ++i){
+			make_line_simd(corners[i - 1], corners[i], pixels);
 		}
+		make_line_simd(corners.back(), to, pixels);
 	}
-
-	// Update clock hands
-	for(size_t i = 0; i < clock_data.size(); ++i){
-		make_hands(clock_centers[i], clock_radii[i], pixels, ta);
+	if(dedup && temporary_seen.reset(Rect(origin.x, origin.y, origin.x + width, origin.y + height))){
+		pixels.next = temporary_seen.filter(temporary.vertices, pixels.next);
 	}
+	temporary.finish(pixels);
+	geometry.stop();
+
+	// Update clock hands that have moved
+	clock_hands.update(ta, zoom);
 
 	// Draw all temporary pixels
-	VertexBuffer(pixels).draw();
-	pixels.clear();
+	perf_group = PERF_TEMPORARY;
+	{
+		PerfTimer timer(PERF_DRAW);
+		perf_vertices(temporary.size / 2);
+		temporary.draw();
+	}
 	
-	// Draw all saved pixel data
-	draw_buffers(line_data);
-	draw_buffers(curve_data);
-	draw_buffers(circle_data);
-	draw_buffers(clock_data);
-
+	// Draw saved pixel data, building only what's in the area
+	perf_group = PERF_SHAPES;
+	store.draw(area, tier);
+	perf_group = PERF_CLOCK_HANDS;
+	if(clock_hands.bounds().intersects(area)){
+		clock_hands.draw();
+	}
 
 	// Draw saved control points
 	if(draw_control_points){
 		glColor3fv(GREEN);
-		draw_buffers(control_data);
+		perf_group = PERF_CONTROLS;
+		store.draw_controls(area, tier);
 		glColor3fv(WHITE);
 	}
-
-	glutPostRedisplay();
+	glPopMatrix();
 }
 
-// Draw every vertex buffer in a vector
-void DrawContext::draw_buffers(vector<VertexBuffer*> &buffers){
-	for(size_t i = 0; i < buffers.size(); ++i){
-		buffers[i]->draw();
+// Rasterize everything that's saved (no UI or rubber-banding) on the
+// CPU so the export doesn't depend on what GL happens to have in the
+// back buffer. Shapes are drawn again from the scene, on every core, at
+// whatever size was asked for. Clock hands come from the scene and the
+// time too: the window's ClockHands and store layers are never touched,
+// so the on-screen caches stay built for the tier being looked at.
+//
+// A window that's been resized very large can ask for more than a Raster
+// can be, so the scale is cut to fit. Past that, the memory may still not
+// be there; the export is abandoned and the status line says so.
+void DrawContext::export_image(GLfloat scale){
+	GLint longest = width > height ? width : height;
+	if(longest * scale > RASTER_MAX_SIDE){
+		scale = (GLfloat)RASTER_MAX_SIDE / longest;
 	}
-}
-
-// All saved pixel data is saved in a shape-specific stack.
-// Each mode supports full undo by popping from its respective
-// stack.
-void DrawContext::undo(){
-	switch(draw_state){
-	case LINE:
-		if(line_data.size()){
-			delete line_data.back();
-			line_data.pop_back();
-		}
-		break;
-	case CURVE:
-		if(curve_data.size() && !drawing_curve){
-			delete curve_data.back();
-			curve_data.pop_back();
-			delete control_data.back();
-			control_data.pop_back();
-		}
-		break;
-	case CIRCLE:
-		if(circle_data.size()){
-			delete circle_data.back();
-			circle_data.pop_back();
-		}
-		break;
-	case CLOCK:
-		if(clock_data.size()){
-			delete clock_data.back();
-			clock_data.pop_back();
-			clock_centers.pop_back();
-			clock_radii.pop_back();
+	GLint w = (GLint)(width * scale);
+	GLint h = (GLint)(height * scale);
+	try{
+		Raster raster(w > 0 ? w : 1, h > 0 ? h : 1, RGBA32);
+		raster.clear(BLACK);
+		raster.set_color(WHITE);
+		time_t t = time(NULL);
+		TimeAngle ta(localtime(&t));
+		render_tiles(store.scene(), ta, draw_control_points, raster, pool, scale, smooth_export);
+		if(!raster.write_png(EXPORT_PATH)){
+			notice = "export not written";
 		}
-		break;
-	default:
-		break;
+	}catch(bad_alloc &){
+		notice = "export too big for memory";
 	}
 }
 
-// Delete vertex buffers from vector
-void DrawContext::delete_buffers(vector<VertexBuffer*> &buffers){
-	for(size_t i = 0; i < buffers.size(); ++i){
-		delete buffers[i];
-	}
-	buffers.clear();
-}
-
 // Lines, Circles, and Clocks work like so:
 // MOUSE DOWN -> Shape starting point - rubber-banding
 // DRAG
@@ -243,14 +358,13 @@ void DrawContext::point_start(GLint button, GLint x, GLint y){
 		case CIRCLE:
 		case CLOCK:
 			if(in_window(x, y)){
-				start.x = x;
-				start.y = y;
+				start = to_world(x, y);
 			}
 			break;
 		case CURVE:
 			if(in_window(x, y)){
 				drawing_curve = true;
-				control_points.push_back(Point2D(x, y));
+				control_points.push_back(to_world(x, y));
 			}
 			break;
 		default:
@@ -262,56 +376,111 @@ void DrawContext::point_start(GLint button, GLint x, GLint y){
 // Mouse up events as described above. Create and save shapes here.
 void DrawContext::point_finish(GLint button, GLint x, GLint y){
 	if(button == GLUT_LEFT_BUTTON){
-		GLint radius;
-		Point2D end(x, y);
-		vector<Point2D> pixels;
+		Point2D end = to_world(x, y);
+		Point2D points[2] = {start, end};
 		switch(draw_state){
 		case LINE:
-			make_line(start, end, pixels);
-			line_data.push_back(new VertexBuffer(pixels));
+			save_shape(Shape(SHAPE_LINE, points, 2, 0));
 			break;
 		case CIRCLE:
-			make_circle(start, int_distance(start, end), pixels);
-			circle_data.push_back(new VertexBuffer(pixels));
+			save_shape(Shape(SHAPE_CIRCLE, &start, 1, int_distance(start, end), fill));
 			break;
 		case CLOCK:
-			radius = int_distance(start, end);
-			make_circle(start, radius, pixels);
-			clock_data.push_back(new VertexBuffer(pixels));
-			clock_centers.push_back(start);
-			clock_radii.push_back(radius);
+			save_shape(Shape(SHAPE_CLOCK, &start, 1, int_distance(start, end), fill));
 			break;
 		case CURVE:
 			if(control_points.size() == 4){
 				drawing_curve = false;
-				make_curve(control_points, pixels);
-				curve_data.push_back(new VertexBuffer(pixels));
-				pixels.clear();
-				for(int i = 0; i < 3; ++i){
-					make_line(control_points[i], control_points[i + 1], pixels);
-				}
-				control_data.push_back(new VertexBuffer(pixels));
+				save_shape(Shape(SHAPE_CURVE, &control_points[0], 4, 0, fill));
 				control_points.clear();
 			}
 			break;
 		default:
 			break;
 		}
-		pixels.clear();
 	}
 }
 
-// Private display callback
+// Keep a finished shape. Its pixels are made when it's next drawn; clocks
+// also need hands.
+void DrawContext::save_shape(const Shape &shape){
+	journal.add(shape);
+}
+
+// Remove every saved shape, in a way that can be undone
+void DrawContext::clear_shapes(){
+	journal.replace(Scene());
+}
+
+// Only the area the shape covered needs drawing again
+void DrawContext::erase_shape(GLint x, GLint y){
+	GLint tolerance = (GLint)ceil(PICK_TOLERANCE / lod_scale(tier));
+	size_t index = store.pick(to_world(x, y), tolerance);
+	if(index == store.scene().size()){
+		return;
+	}
+	Rect area = store.bounds(index);
+	journal.erase(index);
+	scheduler.invalidate(to_screen(area));
+}
+
+// Save the scene in both forms
+void DrawContext::write_scene_files(){
+	write_scene(SCENE_PATH, store.scene());
+	write_scene_text(SCENE_TEXT_PATH, store.scene());
+}
+
+// Replace everything with the shapes in the scene file. A file that
+// doesn't load leaves the sketch alone; one that does can be undone.
+void DrawContext::read_scene_file(){
+	Scene loaded;
+	if(!read_scene(SCENE_PATH, loaded)){
+		return;
+	}
+	journal.replace(loaded);
+}
+
+// Private display callback. Only the dirty area is cleared and drawn,
+// with the scissor trimming whatever reaches outside it. After a swap the
+// back buffer holds the last frame or the one before, depending on the
+// driver, so the area the last frame drew is drawn again too. A redisplay
+// with nothing dirty came from the window system, and draws everything.
 void DrawContext::on_display(){
+	if(perf_enabled){
+		perf_begin_frame();
+	}
+	Rect canvas(0, 0, width, height);
+	Rect dirty = scheduler.dirty().empty() ? canvas : scheduler.dirty();
+	Rect area = dirty;
+	area.unite(last_dirty);
+	area = area.intersection(canvas);
+	last_dirty = dirty;
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(area.x0, height - area.y1, area.x1 - area.x0, area.y1 - area.y0);
 	glClear(GL_COLOR_BUFFER_BIT);
 	draw_interface();
-	draw_shapes();
+	draw_shapes(to_saved(area));
+	glDisable(GL_SCISSOR_TEST);
 	glutSwapBuffers();
+	scheduler.drawn();
+	if(perf_enabled){
+		perf_end_frame(last_frame);
+		last_frame.cached_bytes = store.cached_bytes();
+		if(trace){
+			perf_trace(trace, last_frame);
+		}
+	}
+
+	// Keep ticking only while there's a clock to move
+	if(clock_hands.size() || (pressing && draw_state == CLOCK)){
+		scheduler.schedule_tick(smooth_seconds, DrawContext::Timer);
+	}
 }
 
 // Private keyboard callback
 void DrawContext::on_keyboard(unsigned char key, int x, int y){
 	State old_state = draw_state;
+	notice = 0;
 	switch (key){
 	
 	// Toggle help menu
@@ -329,19 +498,90 @@ void DrawContext::on_keyboard(unsigned char key, int x, int y){
 	// Clear screen
 	case 'x':
 	case 'X':
-		delete_buffers(line_data);
-		delete_buffers(circle_data);
-		delete_buffers(curve_data);
-		delete_buffers(control_data);
-		delete_buffers(clock_data);
-		clock_centers.clear();
-		clock_radii.clear();
+		clear_shapes();
+		break;
+
+	// Frame stats on screen, and to a file
+	case 'f':
+	case 'F':
+		show_stats = !show_stats;
+		set_tracing(trace != 0);
+		break;
+	case 't':
+	case 'T':
+		set_tracing(!trace);
+		break;
+
+	// Drop pixels that are already drawn before they're sent to GL
+	case 'd':
+	case 'D':
+		dedup = !dedup;
+		store.set_dedup(dedup);
+		break;
+
+	// Toggle filling new shapes
+	case 'n':
+	case 'N':
+		fill = !fill;
+		break;
+
+	// Toggle smooth second hands
+	case 'm':
+	case 'M':
+		smooth_seconds = !smooth_seconds;
 		break;
 
-	// Undo last addition in current mode
+	// Write saved shapes to an image file, anti-aliased or not
+	case 'a':
+	case 'A':
+		smooth_export = !smooth_export;
+		break;
+	case 'e':
+	case 'E':
+		export_image(1.0f);
+		break;
+	case 'g':
+	case 'G':
+		export_image((GLfloat)EXPORT_4K_WIDTH / width);
+		break;
+
+	// Save and load the scene
+	case 'w':
+	case 'W':
+		write_scene_files();
+		break;
+	case 'r':
+	case 'R':
+		read_scene_file();
+		break;
+
+	// Zoom about the pointer, and go back to the saved size
+	case '+':
+	case '=':
+		if(tier + 1 < LOD_TIERS){
+			zoom_to(tier + 1, x, y);
+		}
+		break;
+	case '-':
+	case '_':
+		if(tier > 0){
+			zoom_to(tier - 1, x, y);
+		}
+		break;
+	case '0':
+		tier = LOD_ONE;
+		origin = Point2D(0, 0);
+		mouse = to_world(x, y);
+		break;
+
+	// Step back or forward through everything done to the sketch
 	case 'u':
 	case 'U':
-		undo();
+		journal.undo();
+		break;
+	case 'y':
+	case 'Y':
+		journal.redo();
 		break;
 
 	// Change drawing states
@@ -376,7 +616,7 @@ void DrawContext::on_keyboard(unsigned char key, int x, int y){
 	if(old_state == CURVE && old_state != draw_state){
 		control_points.clear();
 	}
-	glutPostRedisplay();
+	scheduler.invalidate();
 }
 
 // Private mouse-button-press callback
@@ -389,20 +629,64 @@ void DrawContext::on_mouse(int button, int state, int x, int y){
 			point_finish(button, x, y);
 			pressing = false;
 		}
+		scheduler.invalidate();
+	}else if(button == GLUT_RIGHT_BUTTON && state == GLUT_DOWN){
+		erase_shape(x, y);
 	}
-	glutPostRedisplay();
 }
 
-// Private motion callback
+// Private motion callback. Unless something is rubber-banding, moving
+// the mouse only changes the status line.
 void DrawContext::on_motion(int x, int y){
-	mouse.x = x;
-	mouse.y = y;
-	glutPostRedisplay();
+	mouse = to_world(x, y);
+	if(pressing || drawing_curve){
+		scheduler.invalidate();
+	}else{
+		scheduler.invalidate(Rect(0, height - MOUSE_POS.y - 13, width, height));
+	}
 }
 
-// Private resize callback
+// Private timer callback. Redraw whatever clocks are on screen. With
+// every clock panned off, the scheduler drops the rectangle, nothing is
+// drawn, and the timer lapses until something else redraws the window.
+void DrawContext::on_timer(int value){
+	scheduler.tick();
+	if(pressing && draw_state == CLOCK){
+		scheduler.invalidate();
+	}else{
+		scheduler.invalidate(to_screen(clock_hands.bounds()));
+	}
+}
+
+// Private resize callback. Saved shapes are in window pixels, so a
+// resize only changes how much of them is visible.
 void DrawContext::on_resize(GLint newWidth, GLint newHeight){
-	glutReshapeWindow(WIDTH, HEIGHT);
+	width = newWidth > 0 ? newWidth : 1;
+	height = newHeight > 0 ? newHeight : 1;
+	set_projection();
+	scheduler.resize(width, height);
+}
+
+// Private special key callback. Arrows pan.
+void DrawContext::on_special(int key, int x, int y){
+	switch(key){
+	case GLUT_KEY_LEFT:
+		origin.x -= PAN_STEP;
+		break;
+	case GLUT_KEY_RIGHT:
+		origin.x += PAN_STEP;
+		break;
+	case GLUT_KEY_UP:
+		origin.y -= PAN_STEP;
+		break;
+	case GLUT_KEY_DOWN:
+		origin.y += PAN_STEP;
+		break;
+	default:
+		return;
+	}
+	mouse = to_world(x, y);
+	scheduler.invalidate();
 }
 
 // Public callbacks must get singleton and call corresponding
@@ -415,6 +699,10 @@ void DrawContext::Keyboard(unsigned char key, int x, int y){
 	get_instance().on_keyboard(key, x, y); 
 }
 
+void DrawContext::Special(int key, int x, int y){
+	get_instance().on_special(key, x, y);
+}
+
 void DrawContext::Mouse(int button, int state, int x, int y){
 	get_instance().on_mouse(button, state, x, y);
 }
@@ -427,4 +715,8 @@ void DrawContext::Resize(GLint newWidth, GLint newHeight){
 	get_instance().on_resize(newWidth, newHeight);
 }
 
+void DrawContext::Timer(int value){
+	get_instance().on_timer(value);
+}
+
 #endif
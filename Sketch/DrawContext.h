@@ -2,10 +2,20 @@
 #define DRAW_CONTEXT_H
 
 #include <vector>
+#include <cstdio>
 using namespace std;
 
 #include "Globals.h"
 #include "VertexBuffer.h"
+#include "Scheduler.h"
+#include "ClockHands.h"
+#include "Shape.h"
+#include "ShapeStore.h"
+#include "ThreadPool.h"
+#include "Journal.h"
+#include "Perf.h"
+#include "TextBlock.h"
+#include "Occupancy.h"
 
 // DrawContext can be in one of 5 states 
 enum State { LINE, CIRCLE, CURVE, CLOCK, UNKNOWN };
@@ -18,9 +28,11 @@ public:
 	// callbacks).
 	static void Display(void);
 	static void Keyboard(unsigned char key, int x, int y);
+	static void Special(int key, int x, int y);
 	static void Mouse(int button, int state, int x, int y);
 	static void Motion(int x, int y);
 	static void Resize(GLint newWidth, GLint newHeight);
+	static void Timer(int value);
 
 private:
 	// Get private singleton
@@ -34,44 +46,86 @@ private:
 	// Private callbacks called by public callbacks.
 	void on_display(void);
 	void on_keyboard(unsigned char key, int x, int y);
+	void on_special(int key, int x, int y);
 	void on_mouse(int button, int state, int x, int y);	
 	void on_motion(int x, int y);
 	void on_resize(GLint newWidth, GLint newHeight);
+	void on_timer(int value);
 
-	// Write text to screen
-	void write(ostringstream &os, GLfloat x, GLfloat y, float *color);
+	// Map window pixels one to one onto the drawing, y down
+	void set_projection(void);
 
 	// Draw menu and mouse position
 	void draw_interface(void);
 
+	// Draw the last frame's measurements
+	void draw_stats(void);
+
+	// Start or stop writing a line per frame to TRACE_PATH
+	void set_tracing(bool on);
+
 	// Is x, y in window?
 	bool in_window(int x, int y);
 
-	// Truncated distance from start to end
-	GLint int_distance(Point2D &start, Point2D &end);
+	// Convert between window pixels, the current LOD tier, and the saved
+	// coordinates shapes are kept in
+	Point2D to_world(GLint x, GLint y);
+	Point2D to_view(const Point2D &p);
+	GLint to_view(GLint length);
+	Rect to_screen(const Rect &area);
+	Rect to_saved(const Rect &area);
 
-	// Draw everything
-	void draw_shapes(void);
+	// Change zoom level keeping the point under (x, y) still, and
+	// re-derive the cursor position shown in the status line
+	void zoom_to(size_t new_tier, GLint x, GLint y);
 
-	// Draw every vertex buffer in a vector
-	void draw_buffers(vector<VertexBuffer*> &buffers);
+	// Truncated distance from start to end
+	GLint int_distance(Point2D &start, Point2D &end);
 
-	// Pop shape data from vector
-	void undo(void);
+	// Draw everything that might touch area (in saved coordinates)
+	void draw_shapes(const Rect &area);
 
-	// Delete vertex buffers from vector
-	void delete_buffers(vector<VertexBuffer*> &buffers);
+	// Render saved shapes into a CPU framebuffer scale times the size of
+	// the window and write it to disk. The scale is cut down if that would
+	// be over RASTER_MAX_SIDE; running out of memory leaves a notice.
+	void export_image(GLfloat scale);
 
 	// Rubber band UI
 	void point_start(GLint button, GLint x, GLint y);
 	void point_finish(GLint button, GLint x, GLint y);
 
+	// Add a finished shape to the sketch
+	void save_shape(const Shape &shape);
+
+	// Remove every saved shape
+	void clear_shapes(void);
+
+	// Remove the shape under (x, y), if there is one
+	void erase_shape(GLint x, GLint y);
+
+	// Save the scene to SCENE_PATH and SCENE_TEXT_PATH, or load it back
+	// from SCENE_PATH
+	void write_scene_files(void);
+	void read_scene_file(void);
+
 	// State variables
 	bool draw_menu;					// Should we draw the help menu?
 	bool draw_control_points;		// Should we draw the control points?
 	bool drawing_curve;				// Are we drawing a curve right now?
 	bool pressing;					// Is the mouse button down?
+	bool smooth_seconds;			// Sweep second hands between ticks?
+	bool dedup;						// Drop pixels already drawn?
+	bool smooth_export;				// Anti-alias exported images?
+	bool fill;						// Are new circles, clocks and curves filled?
+	bool show_stats;				// Should we draw frame measurements?
+	FILE *trace;					// Per-frame trace, if one is being written
+	const char *notice;				// Shown after the status line until the next key
+	FrameStats last_frame;			// Measurements from the last frame drawn
 	State draw_state;				// Which draw state are we in?
+	GLint width;					// Window size in pixels
+	GLint height;
+	size_t tier;					// LOD tier the view is zoomed to
+	Point2D origin;					// Top left of the window, in tier pixels
 
 	// Current end points for line/circle/clock
 	Point2D start;
@@ -80,16 +134,30 @@ private:
 	// Current control points for curve
 	vector<Point2D> control_points;
 
-	// Saved data
-	vector<VertexBuffer*> line_data;
-	vector<VertexBuffer*> curve_data;
-	vector<VertexBuffer*> circle_data;
-	vector<VertexBuffer*> control_data;
-	vector<VertexBuffer*> clock_data;
+	// Tracks what needs redrawing and when
+	Scheduler scheduler;
+	Rect last_dirty;				// Window area the last frame drew
+
+	// Saved shapes, and their pixels as far as the cache budget goes
+	ShapeStore store;
 
 	// Clocks need extra data =(
-	vector<Point2D> clock_centers;
-	vector<GLint> clock_radii;
+	ClockHands clock_hands;
+
+	// Every change to the store and clocks goes through here, for undo
+	Journal journal;
+
+	// Off-screen rendering
+	ThreadPool pool;
+
+	// On-screen text, laid out when it changes
+	TextBlock toggle_text;
+	TextBlock menu_text;
+	TextBlock status_text;
+	TextBlock stats_text;
+
+	// Rubber-band pixels drawn this frame, with dedup on
+	Occupancy temporary_seen;
 };
 
 #endif
@@ -0,0 +1,40 @@
+#include <cstring>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Extensions.h"
+
+PFNGENBUFFERS pglGenBuffers = 0;
+PFNDELETEBUFFERS pglDeleteBuffers = 0;
+PFNBINDBUFFER pglBindBuffer = 0;
+PFNBUFFERDATA pglBufferData = 0;
+PFNBUFFERSUBDATA pglBufferSubData = 0;
+
+// Core name first, then the ARB extension name
+static PROC get_proc(const char *core, const char *arb){
+	PROC proc = wglGetProcAddress(core);
+	if(!proc){
+		proc = wglGetProcAddress(arb);
+	}
+	return proc;
+}
+
+void load_extensions(void){
+	const char *version = (const char*)glGetString(GL_VERSION);
+	const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+	bool core = version && (version[0] > '1' || (version[0] == '1' && version[2] >= '5'));
+	bool arb = extensions && strstr(extensions, "GL_ARB_vertex_buffer_object");
+	if(!core && !arb){
+		return;
+	}
+	pglGenBuffers = (PFNGENBUFFERS)get_proc("glGenBuffers", "glGenBuffersARB");
+	pglDeleteBuffers = (PFNDELETEBUFFERS)get_proc("glDeleteBuffers", "glDeleteBuffersARB");
+	pglBindBuffer = (PFNBINDBUFFER)get_proc("glBindBuffer", "glBindBufferARB");
+	pglBufferData = (PFNBUFFERDATA)get_proc("glBufferData", "glBufferDataARB");
+	pglBufferSubData = (PFNBUFFERSUBDATA)get_proc("glBufferSubData", "glBufferSubDataARB");
+}
+
+bool have_buffer_objects(void){
+	return pglGenBuffers && pglDeleteBuffers && pglBindBuffer && pglBufferData && pglBufferSubData;
+}
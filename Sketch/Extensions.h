@@ -0,0 +1,39 @@
+#ifndef EXTENSIONS_H
+#define EXTENSIONS_H
+
+#include "Globals.h"
+
+// Buffer object enums from GL 1.5 (not in Windows' 1.1 gl.h)
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
+typedef ptrdiff_t GLsizeiptr_t;
+typedef ptrdiff_t GLintptr_t;
+
+// Buffer object entry points, looked up at runtime
+typedef void (APIENTRY *PFNGENBUFFERS)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *PFNDELETEBUFFERS)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *PFNBINDBUFFER)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *PFNBUFFERDATA)(GLenum target, GLsizeiptr_t size, const GLvoid *data, GLenum usage);
+typedef void (APIENTRY *PFNBUFFERSUBDATA)(GLenum target, GLintptr_t offset, GLsizeiptr_t size, const GLvoid *data);
+
+extern PFNGENBUFFERS pglGenBuffers;
+extern PFNDELETEBUFFERS pglDeleteBuffers;
+extern PFNBINDBUFFER pglBindBuffer;
+extern PFNBUFFERDATA pglBufferData;
+extern PFNBUFFERSUBDATA pglBufferSubData;
+
+// Look up extension entry points. Needs a current context, so call it
+// after the window is created.
+void load_extensions(void);
+
+// True when saved geometry can live in buffer objects. Otherwise (e.g.
+// the GDI generic renderer, or a software Mesa without the extension)
+// everything is drawn from client arrays as before.
+bool have_buffer_objects(void);
+
+#endif
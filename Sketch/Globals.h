@@ -7,9 +7,9 @@
 #include <cmath>
 #include <ctime>
 
-// Global constants
-const GLint WIDTH = 800;
-const GLint HEIGHT = 600;
+// Global constants. The window starts at this size but can be resized.
+const GLint DEFAULT_WIDTH = 800;
+const GLint DEFAULT_HEIGHT = 600;
 const GLfloat PI = 3.14159265;
 const GLfloat PI_OVER_180 = PI / 180.0;
 const GLfloat PI_OVER_2 = PI / 2.0;
@@ -28,15 +28,43 @@ static const char *MENU[] = {
 	"| O - Circle          |",
 	"| S - Curve           |",
 	"| C - Clock           |",
+	"| N - Fill            |",
 	"| P - Control Points  |",
+	"| M - Smooth Seconds  |",
+	"| D - Dedup Pixels    |",
+	"| F - Frame Stats     |",
+	"| T - Trace Frames    |",
+	"| E - Export Image    |",
+	"| G - Export 4K Image |",
+	"| A - Smooth Export   |",
+	"| + - Zoom In         |",
+	"| - - Zoom Out        |",
+	"| 0 - Reset View      |",
+	"| Arrows - Pan        |",
+	"| W - Write Scene     |",
+	"| R - Read Scene      |",
 	"| U - Undo            |",
+	"| Y - Redo            |",
+	"| Right Click - Erase |",
 	"| X - Clear           |",
 	"| Q - Quit            |",
 	"+---------------------+"
 };
 const GLint MENU_SIZE = sizeof(MENU) / sizeof(char*);
 
+// Exported images are written here
+const char EXPORT_PATH[] = "sketch.png";
+
+// Scenes are saved here (binary, and text for diffing) and loaded from
+// SCENE_PATH, which can hold either form
+const char SCENE_PATH[] = "sketch.scene";
+const char SCENE_TEXT_PATH[] = "sketch.scene.txt";
+
+// Frame measurements are traced here, as CSV
+const char TRACE_PATH[] = "sketch.trace.csv";
+
 // Useful colors
+const GLfloat BLACK[] = {0.0f, 0.0f, 0.0f};
 const GLfloat BLUE[] = {0.0f, 0.4f, 1.0f};
 const GLfloat GREEN[] = {0.0f, 1.0f, 0.4};
 const GLfloat RED[] = {1.0f, 0.0f, 0.0f};
@@ -52,6 +80,76 @@ struct Point2D{
 	Point2D(GLint xc, GLint yc): x(xc), y(yc) {}
 };
 
+// Represents a run of pixels in one row, x0 through x1 inclusive.
+// Vertical runs are stored swapped (like swap_set_pixel): y holds the
+// column and x0 through x1 the rows.
+struct Span{
+	GLint y;
+	GLint x0;
+	GLint x1;
+	bool vertical;
+
+	// Constructors
+	Span(): y(0), x0(0), x1(0), vertical(false) {}
+	Span(GLint yc, GLint x0c, GLint x1c, bool v): y(yc), x0(x0c), x1(x1c), vertical(v) {}
+};
+
+// How a closed path is filled: pixels are inside when a ray from them
+// crosses the outline an odd number of times, or any number but zero
+// counting crossings in each direction against each other
+enum FillRule { FILL_EVEN_ODD, FILL_NON_ZERO };
+
+// Writes pixels straight out as GL_POINTS vertices (two floats each) into
+// storage someone else owns and has already sized, e.g. with line_size
+struct VertexWriter{
+	GLfloat *next;
+
+	// Constructors
+	VertexWriter(): next(0) {}
+	VertexWriter(GLfloat *v): next(v) {}
+};
+
+// Represents an axis-aligned screen rectangle, x0/y0 inclusive and
+// x1/y1 exclusive, in window coordinates (y down)
+struct Rect{
+	GLint x0;
+	GLint y0;
+	GLint x1;
+	GLint y1;
+
+	// Constructors
+	Rect(): x0(0), y0(0), x1(0), y1(0) {}
+	Rect(GLint x0c, GLint y0c, GLint x1c, GLint y1c): x0(x0c), y0(y0c), x1(x1c), y1(y1c) {}
+
+	bool empty() const { return x0 >= x1 || y0 >= y1; }
+
+	// Do the two overlap at all?
+	bool intersects(const Rect &r) const {
+		return !empty() && !r.empty() && x0 < r.x1 && r.x0 < x1 && y0 < r.y1 && r.y0 < y1;
+	}
+
+	// Part of both, empty when they don't overlap
+	Rect intersection(const Rect &r) const {
+		return Rect(r.x0 > x0 ? r.x0 : x0, r.y0 > y0 ? r.y0 : y0,
+			r.x1 < x1 ? r.x1 : x1, r.y1 < y1 ? r.y1 : y1);
+	}
+
+	// Smallest rectangle covering both
+	void unite(const Rect &r){
+		if(r.empty()){
+			return;
+		}
+		if(empty()){
+			*this = r;
+			return;
+		}
+		x0 = r.x0 < x0 ? r.x0 : x0;
+		y0 = r.y0 < y0 ? r.y0 : y0;
+		x1 = r.x1 > x1 ? r.x1 : x1;
+		y1 = r.y1 > y1 ? r.y1 : y1;
+	}
+};
+
 // We have to recalculate time every frame, so we calculate everything
 // that's not dependent on a specific circle's radius here once only.
 struct TimeAngle{
@@ -62,11 +160,12 @@ struct TimeAngle{
 	GLfloat sec_cos;
 	GLfloat sec_sin;
 
-	TimeAngle(tm *now){
+	// millis moves the second hand between ticks in smooth mode
+	TimeAngle(tm *now, GLint millis = 0){
 		// Convert hour/min/sec angles to radians
 		GLfloat hourRad = (now->tm_hour % 12) / 12.0 * 360 * PI_OVER_180 - PI_OVER_2;
 		GLfloat minRad = now->tm_min / 60.0 * 360 * PI_OVER_180 - PI_OVER_2;
-		GLfloat secRad = now->tm_sec / 60.0 * 360 * PI_OVER_180 - PI_OVER_2;
+		GLfloat secRad = (now->tm_sec + millis / 1000.0) / 60.0 * 360 * PI_OVER_180 - PI_OVER_2;
 
 		// Calculate endpoint of hand (without radius)
 		hour_cos = 0.50 * cos(hourRad);
@@ -78,8 +177,28 @@ struct TimeAngle{
 	}
 };
 
-// Menu and mouse coordinates position
+// Curves are flattened until they're within this many pixels of true
+const GLfloat CURVE_FLATNESS = 0.5f;
+const GLint MAX_CURVE_DEPTH = 16;
+
+// Clock redraw period in smooth-seconds mode
+const GLint SMOOTH_TICK_MS = 50;
+
+// Menu position from the top left, and mouse coordinates position from
+// the bottom left
 const Point2D MOUSE_POS(12, 24);
-const Point2D MENU_POS(12, HEIGHT - 24);
+const Point2D MENU_POS(12, 24);
+
+// Width of the frame stats, drawn against the right edge
+const GLint STATS_WIDTH = 300;
+
+// How far the arrow keys pan, in window pixels
+const GLint PAN_STEP = 64;
+
+// How close a right click has to be to a shape to erase it, in pixels
+const GLint PICK_TOLERANCE = 4;
+
+// Width of the high-resolution export
+const GLint EXPORT_4K_WIDTH = 3840;
 
 #endif
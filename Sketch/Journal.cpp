@@ -0,0 +1,146 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Shape.h"
+#include "ShapeStore.h"
+#include "ClockHands.h"
+#include "Journal.h"
+
+Journal::Journal(ShapeStore &s, ClockHands &h):
+	store(s),
+	hands(h),
+	done(),
+	undone()
+{
+}
+
+Journal::~Journal(){
+	for(size_t i = 0; i < done.size(); ++i){
+		discard(done[i]);
+	}
+	for(size_t i = 0; i < undone.size(); ++i){
+		discard(undone[i]);
+	}
+}
+
+void Journal::add(const Shape &shape){
+	Command command = {COMMAND_ADD, shape, store.scene().size(), 0, 0};
+	apply(command);
+	record(command);
+}
+
+void Journal::erase(size_t i){
+	Command command = {COMMAND_ERASE, store.scene()[i], i, 0, 0};
+	apply(command);
+	record(command);
+}
+
+void Journal::replace(const Scene &scene){
+	Command command = {COMMAND_REPLACE, Shape(), 0, new ShapeStore, new ClockHands};
+	exchange(command);
+	for(size_t i = 0; i < scene.size(); ++i){
+		store.push(scene[i]);
+		if(scene[i].kind == SHAPE_CLOCK){
+			hands.push(scene[i].points[0], scene[i].radius, scene[i].filled);
+		}
+	}
+	record(command);
+}
+
+bool Journal::undo(void){
+	if(done.empty()){
+		return false;
+	}
+	revert(done.back());
+	undone.push_back(done.back());
+	done.pop_back();
+	return true;
+}
+
+bool Journal::redo(void){
+	if(undone.empty()){
+		return false;
+	}
+	apply(undone.back());
+	done.push_back(undone.back());
+	undone.pop_back();
+	return true;
+}
+
+// Clocks are only counted when one is erased or put back, a walk over
+// the scene up to it
+size_t Journal::clock_index(size_t i) const{
+	size_t clock = 0;
+	for(size_t j = 0; j < i; ++j){
+		clock += store.scene()[j].kind == SHAPE_CLOCK;
+	}
+	return clock;
+}
+
+void Journal::apply(Command &command){
+	switch(command.kind){
+	case COMMAND_ADD:
+		store.push(command.shape);
+		if(command.shape.kind == SHAPE_CLOCK){
+			hands.push(command.shape.points[0], command.shape.radius, command.shape.filled);
+		}
+		break;
+	case COMMAND_ERASE:
+		if(command.shape.kind == SHAPE_CLOCK){
+			hands.erase(clock_index(command.index));
+		}
+		store.erase(command.index);
+		break;
+	case COMMAND_REPLACE:
+		exchange(command);
+		break;
+	}
+}
+
+// Added shapes are always the newest when they're undone, so they come
+// off the end of the store and the clocks
+void Journal::revert(Command &command){
+	switch(command.kind){
+	case COMMAND_ADD:
+		store.erase(store.scene().size() - 1);
+		if(command.shape.kind == SHAPE_CLOCK){
+			hands.pop();
+		}
+		break;
+	case COMMAND_ERASE:
+		store.insert(command.index, command.shape);
+		if(command.shape.kind == SHAPE_CLOCK){
+			hands.insert(clock_index(command.index), command.shape.points[0], command.shape.radius, command.shape.filled);
+		}
+		break;
+	case COMMAND_REPLACE:
+		exchange(command);
+		break;
+	}
+}
+
+// The same swap both ways round. The parked scene's pixels are dropped so
+// a journal full of clears doesn't hold a cache budget for each; coming
+// back, only what's on screen is rasterized again.
+void Journal::exchange(Command &command){
+	store.swap(*command.store);
+	hands.swap(*command.hands);
+	command.store->drop_cache();
+}
+
+void Journal::discard(Command &command){
+	delete command.store;
+	delete command.hands;
+	command.store = 0;
+	command.hands = 0;
+}
+
+void Journal::record(const Command &command){
+	for(size_t i = 0; i < undone.size(); ++i){
+		discard(undone[i]);
+	}
+	undone.clear();
+	done.push_back(command);
+}
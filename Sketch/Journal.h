@@ -0,0 +1,82 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Shape.h"
+#include "ShapeStore.h"
+#include "ClockHands.h"
+
+// Things that can be done to the sketch
+enum CommandKind { COMMAND_ADD, COMMAND_ERASE, COMMAND_REPLACE };
+
+// One step in the journal, with whatever it takes to run it either way
+struct Command{
+	CommandKind kind;
+	Shape shape;				// Added or erased shape
+	size_t index;				// Where the shape was erased from
+	ShapeStore *store;			// Replace: the scene that isn't showing
+	ClockHands *hands;			// Replace: its clocks
+};
+
+// Journal makes every change to the sketch, and records it so it can be
+// undone and redone in any order the user likes, whatever the drawing
+// state. Adding a shape and undoing it are O(1). Clearing or loading
+// swaps the whole store out into the journal instead of deleting it, so
+// undoing a clear of any size just swaps it back.
+//
+// Erasing, and undoing an erase, are O(n) in the shapes after the one
+// erased: the scene, the grid and the clocks all shift to close or open
+// the gap, and every later cache block is rebuilt when next drawn. It's
+// one shape per right click, so the shift is paid once per click, never
+// per frame.
+class Journal{
+public:
+	Journal(ShapeStore &store, ClockHands &hands);
+	~Journal();
+
+	// Add a shape at the end
+	void add(const Shape &shape);
+
+	// Remove shape i
+	void erase(size_t i);
+
+	// Replace every shape with the ones in scene. Clear is a replace with
+	// an empty scene.
+	void replace(const Scene &scene);
+
+	// Step back or forward. False if there's nothing to step over.
+	bool undo(void);
+	bool redo(void);
+
+private:
+	// Which clock shape i is, counting clocks before it
+	size_t clock_index(size_t i) const;
+
+	// Run a command forward, or backward
+	void apply(Command &command);
+	void revert(Command &command);
+
+	// Trade the live scene with the one parked in a replace command
+	void exchange(Command &command);
+
+	// Free whatever a command owns
+	void discard(Command &command);
+
+	// Record a command that has been applied; anything undone is gone
+	void record(const Command &command);
+
+	ShapeStore &store;
+	ClockHands &hands;
+	vector<Command> done;
+	vector<Command> undone;
+
+	// Journals own parked stores; no copying
+	Journal(Journal const&);
+	void operator=(Journal const&);
+};
+
+#endif
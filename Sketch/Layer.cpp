@@ -0,0 +1,237 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Extensions.h"
+#include "VertexBuffer.h"
+#include "Layer.h"
+#include "Perf.h"
+
+// Where begin has the kernels write. Layers are only built on the GL
+// thread, so one buffer does for all of them, and it stops allocating once
+// it's grown to the biggest shape, up to LAYER_STAGING_KEEP.
+static vector<GLfloat> staging;
+
+// Every vertex already held, as floats from here on. Anything uploaded
+// was shorts, so the buffer object is filled again from scratch.
+void Arena::widen(void){
+	floats.assign(shorts.begin(), shorts.end());
+	vector<GLshort>().swap(shorts);
+	format = VERTEX_FLOAT;
+	uploaded = 0;
+}
+
+// Empty, and back to shorts
+void Arena::clear(void){
+	shorts.clear();
+	vector<GLfloat>().swap(floats);
+	format = VERTEX_SHORT;
+	uploaded = 0;
+}
+
+Layer::Layer():
+	points(GL_POINTS),
+	lines(GL_LINES),
+	shapes()
+{
+}
+
+Layer::~Layer(){
+	if(points.buffer){
+		pglDeleteBuffers(1, &points.buffer);
+	}
+	if(lines.buffer){
+		pglDeleteBuffers(1, &lines.buffer);
+	}
+}
+
+// Pixels as point vertices, GLfloats or GLshorts
+template<class T>
+static void write_points(const vector<Point2D> &pixels, T *v){
+	for(size_t i = 0; i < pixels.size(); ++i, v += 2){
+		v[0] = (T)pixels[i].x;
+		v[1] = (T)pixels[i].y;
+	}
+}
+
+// Spans as line or point vertices
+template<class T>
+static void write_spans(const vector<Span> &spans, bool lines, T *v){
+	for(size_t i = 0; i < spans.size(); ++i){
+		v = lines ? span_vertices(spans[i], v) : span_point_vertices(spans[i], v);
+	}
+}
+
+// Copy pixels onto the end of the point arena
+void Layer::push(vector<Point2D> &pixels){
+	if(points.format == VERTEX_SHORT){
+		for(size_t i = 0; i < pixels.size(); ++i){
+			if(!short_fits(pixels[i].x) || !short_fits(pixels[i].y)){
+				points.widen();
+				break;
+			}
+		}
+	}
+	Extent extent = {&points, points.size(), 2 * pixels.size()};
+	points.resize(extent.first + extent.count);
+	if(extent.count && points.format == VERTEX_SHORT){
+		write_points(pixels, &points.shorts[extent.first]);
+	}else if(extent.count){
+		write_points(pixels, &points.floats[extent.first]);
+	}
+	shapes.push_back(extent);
+}
+
+VertexWriter Layer::begin(size_t max_pixels){
+	staging.resize(2 * max_pixels);
+	return VertexWriter(max_pixels ? &staging[0] : 0);
+}
+
+// The kernels only write whole pixels, so the floats convert exactly
+void Layer::end(const VertexWriter &writer){
+	size_t count = writer.next ? writer.next - &staging[0] : 0;
+	if(points.format == VERTEX_SHORT){
+		for(size_t i = 0; i < count; ++i){
+			if(staging[i] < SHRT_MIN || staging[i] > SHRT_MAX){
+				points.widen();
+				break;
+			}
+		}
+	}
+	Extent extent = {&points, points.size(), count};
+	points.resize(extent.first + extent.count);
+	for(size_t i = 0; i < count; ++i){
+		if(points.format == VERTEX_SHORT){
+			points.shorts[extent.first + i] = (GLshort)staging[i];
+		}else{
+			points.floats[extent.first + i] = staging[i];
+		}
+	}
+	shapes.push_back(extent);
+	if(staging.capacity() > LAYER_STAGING_KEEP){
+		vector<GLfloat>().swap(staging);
+	}
+}
+
+// Spans go to the line arena when they save vertices, otherwise they're
+// expanded onto the point arena. A line vertex ends one past x1.
+void Layer::push(vector<Span> &spans){
+	size_t pixel_count = span_pixels(spans);
+	bool as_lines = spans_pay_off(spans, pixel_count);
+	Extent extent;
+	extent.arena = as_lines ? &lines : &points;
+	Arena &arena = *extent.arena;
+	if(arena.format == VERTEX_SHORT){
+		for(size_t i = 0; i < spans.size(); ++i){
+			if(!short_fits(spans[i].y) || !short_fits(spans[i].x0) || !short_fits(spans[i].x1 + (as_lines ? 1 : 0))){
+				arena.widen();
+				break;
+			}
+		}
+	}
+	extent.first = arena.size();
+	extent.count = as_lines ? 4 * spans.size() : 2 * pixel_count;
+	arena.resize(extent.first + extent.count);
+	if(extent.count && arena.format == VERTEX_SHORT){
+		write_spans(spans, as_lines, &arena.shorts[extent.first]);
+	}else if(extent.count){
+		write_spans(spans, as_lines, &arena.floats[extent.first]);
+	}
+	shapes.push_back(extent);
+}
+
+// The newest shape is always at the end of its arena
+void Layer::pop(void){
+	if(shapes.empty()){
+		return;
+	}
+	Arena &arena = *shapes.back().arena;
+	arena.resize(shapes.back().first);
+	if(arena.uploaded > arena.size()){
+		arena.uploaded = arena.size();
+	}
+	shapes.pop_back();
+}
+
+// Keep the buffer objects around for the next shapes
+void Layer::clear(void){
+	points.clear();
+	lines.clear();
+	shapes.clear();
+}
+
+size_t Layer::size(void) const{
+	return shapes.size();
+}
+
+size_t Layer::bytes(void) const{
+	return points.bytes() + lines.bytes() + shapes.capacity() * sizeof(Extent);
+}
+
+// Appends go in with glBufferSubData. When the buffer is full, grow it
+// geometrically and send everything again so the reallocation cost is
+// amortized over many shapes.
+void Layer::upload(Arena &arena){
+	if(!have_buffer_objects() || arena.uploaded == arena.size()){
+		return;
+	}
+	PerfTimer timer(PERF_UPLOAD);
+	if(!arena.buffer){
+		pglGenBuffers(1, &arena.buffer);
+	}
+	pglBindBuffer(GL_ARRAY_BUFFER, arena.buffer);
+	size_t unit = arena.coordinate_bytes();
+	if(arena.size() * unit > arena.capacity){
+		arena.capacity = (arena.format == VERTEX_SHORT ? arena.shorts.capacity() : arena.floats.capacity()) * unit;
+		pglBufferData(GL_ARRAY_BUFFER, arena.capacity, 0, GL_STATIC_DRAW);
+		arena.uploaded = 0;
+	}
+	pglBufferSubData(GL_ARRAY_BUFFER,
+		arena.uploaded * unit,
+		(arena.size() - arena.uploaded) * unit,
+		arena.data(arena.uploaded));
+	pglBindBuffer(GL_ARRAY_BUFFER, 0);
+	arena.uploaded = arena.size();
+}
+
+// The arena is contiguous, so every shape in it goes in a single call,
+// with GL reading the coordinates as whatever type the arena holds
+void Layer::draw(Arena &arena){
+	if(!arena.size()){
+		return;
+	}
+	upload(arena);
+	PerfTimer timer(PERF_DRAW);
+	perf_vertices(arena.size() / 2);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if(arena.buffer){
+		pglBindBuffer(GL_ARRAY_BUFFER, arena.buffer);
+		glVertexPointer(2, arena.type(), 0, 0);
+		glDrawArrays(arena.mode, 0, arena.size() / 2);
+		pglBindBuffer(GL_ARRAY_BUFFER, 0);
+	}else{
+		glVertexPointer(2, arena.type(), 0, arena.data(0));
+		glDrawArrays(arena.mode, 0, arena.size() / 2);
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void Layer::draw(void){
+	draw(points);
+	draw(lines);
+}
+
+// Same for both formats, but the types have to be spelled out
+static void raster_arena(const Arena &arena, Raster &raster){
+	if(arena.size() && arena.format == VERTEX_SHORT){
+		raster_vertices(arena.mode, &arena.shorts[0], (GLint)(arena.size() / 2), raster);
+	}else if(arena.size()){
+		raster_vertices(arena.mode, &arena.floats[0], (GLint)(arena.size() / 2), raster);
+	}
+}
+
+void Layer::draw(Raster &raster){
+	raster_arena(points, raster);
+	raster_arena(lines, raster);
+}
@@ -0,0 +1,141 @@
+#ifndef LAYER_H
+#define LAYER_H
+
+#include <vector>
+#include <climits>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Raster.h"
+
+// Most floats the buffer Layer::begin hands out keeps between shapes,
+// 256KB. It isn't counted in any layer's bytes, so it's freed after
+// anything bigger.
+const size_t LAYER_STAGING_KEEP = 64 * 1024;
+
+// Coordinate types an arena can hold. Pixels are whole, so nearly every
+// vertex fits in two GLshorts, half the size of two GLfloats; an arena
+// only goes over to floats, for good, when one doesn't.
+enum VertexFormat { VERTEX_SHORT, VERTEX_FLOAT };
+
+// Does a coordinate fit in a GLshort?
+inline bool short_fits(GLint c){
+	return c >= SHRT_MIN && c <= SHRT_MAX;
+}
+
+// Arena holds the vertices for every shape in a layer drawn with one
+// primitive type, back to back in one array (and, when the driver has
+// them, one buffer object).
+struct Arena{
+	Arena(GLenum m): mode(m), format(VERTEX_SHORT), shorts(), floats(), buffer(0), capacity(0), uploaded(0) {}
+
+	GLenum mode;				// GL_POINTS or GL_LINES
+	VertexFormat format;
+	vector<GLshort> shorts;		// Host copy, two coordinates per vertex, while VERTEX_SHORT
+	vector<GLfloat> floats;		// The same once it's VERTEX_FLOAT
+	GLuint buffer;				// Buffer object, or 0 if drawn from the host copy
+	size_t capacity;			// Bytes allocated in buffer
+	size_t uploaded;			// Coordinates already in buffer
+
+	// Coordinates held, two per vertex
+	size_t size(void) const {
+		return format == VERTEX_SHORT ? shorts.size() : floats.size();
+	}
+
+	// Bytes per coordinate, and the GL type to draw them as
+	size_t coordinate_bytes(void) const {
+		return format == VERTEX_SHORT ? sizeof(GLshort) : sizeof(GLfloat);
+	}
+	GLenum type(void) const {
+		return format == VERTEX_SHORT ? GL_SHORT : GL_FLOAT;
+	}
+
+	// Host copy from coordinate first on
+	const void *data(size_t first) const {
+		return format == VERTEX_SHORT ? (const void*)&shorts[first] : (const void*)&floats[first];
+	}
+
+	void resize(size_t count){
+		if(format == VERTEX_SHORT){
+			shorts.resize(count);
+		}else{
+			floats.resize(count);
+		}
+	}
+
+	// Host memory held
+	size_t bytes(void) const {
+		return shorts.capacity() * sizeof(GLshort) + floats.capacity() * sizeof(GLfloat);
+	}
+
+	// Go over to floats, keeping every vertex
+	void widen(void);
+
+	// Drop every vertex
+	void clear(void);
+};
+
+// Where one shape's vertices live
+struct Extent{
+	Arena *arena;
+	size_t first;				// Offset into the arena, in coordinates
+	size_t count;				// Length, in coordinates
+};
+
+// Layer stores every saved shape of one kind (lines, circles, ...) in two
+// arenas, one for points and one for spans, plus an index of where each
+// shape starts. Shapes are only ever added and removed at the end, so
+// undo just truncates the arena, and drawing the whole layer is one
+// glDrawArrays per arena no matter how many shapes it holds.
+class Layer{
+public:
+	Layer();
+	~Layer();
+
+	// Append one shape
+	void push(vector<Point2D> &pixels);
+	void push(vector<Span> &spans);
+
+	// Append one shape straight from the kernels: begin returns a writer
+	// aimed at room for up to max_pixels float points, shared by every
+	// layer, and end packs however many the writer actually wrote onto the
+	// point arena. Nothing else may begin a shape in between.
+	VertexWriter begin(size_t max_pixels);
+	void end(const VertexWriter &writer);
+
+	// Remove the most recent shape
+	void pop(void);
+
+	// Remove every shape
+	void clear(void);
+
+	// Number of shapes
+	size_t size(void) const;
+
+	// Host memory held for vertices and the shape index
+	size_t bytes(void) const;
+
+	// Draw with GL, uploading anything new first
+	void draw(void);
+
+	// Draw into a CPU framebuffer
+	void draw(Raster &raster);
+
+private:
+	// Send vertices added since the last draw to the buffer object
+	void upload(Arena &arena);
+
+	// Draw an arena with GL
+	void draw(Arena &arena);
+
+	Arena points;
+	Arena lines;
+	vector<Extent> shapes;
+
+	// Layers own buffer objects; no copying
+	Layer(Layer const&);
+	void operator=(Layer const&);
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Occupancy.h"
+
+Occupancy::Occupancy():
+	area(),
+	row_words(0),
+	bits()
+{
+}
+
+bool Occupancy::reset(const Rect &cover){
+	size_t width = cover.empty() ? 0 : (size_t)(cover.x1 - cover.x0);
+	size_t height = cover.empty() ? 0 : (size_t)(cover.y1 - cover.y0);
+	if(!width || height > OCCUPANCY_MAX_PIXELS / width){
+		area = Rect();
+		return false;
+	}
+	area = cover;
+	row_words = (width + 31) / 32;
+	bits.assign(row_words * height, 0);
+	return true;
+}
+
+// Vertices hold whole pixels, so the float to int is exact
+GLfloat *Occupancy::filter(GLfloat *first, GLfloat *last){
+	GLfloat *out = first;
+	for(GLfloat *v = first; v < last; v += 2){
+		if(!test_and_set((GLint)v[0], (GLint)v[1])){
+			out[0] = v[0];
+			out[1] = v[1];
+			out += 2;
+		}
+	}
+	return out;
+}
+
+void Occupancy::filter(vector<Span> &spans){
+	size_t kept = 0;
+	for(size_t i = 0; i < spans.size(); ++i){
+		if(trim(spans[i])){
+			spans[kept++] = spans[i];
+		}
+	}
+	spans.resize(kept);
+}
+
+// Vertical runs are stored swapped, so y is their column
+bool Occupancy::trim(Span &span){
+	bool vertical = span.vertical;
+	GLint x0 = span.x0, x1 = span.x1;
+	while(x0 <= x1 && (vertical ? test_and_set(span.y, x0) : test_and_set(x0, span.y))){
+		++x0;
+	}
+	while(x1 > x0 && (vertical ? test_and_set(span.y, x1) : test_and_set(x1, span.y))){
+		--x1;
+	}
+	for(GLint x = x0 + 1; x < x1; ++x){
+		vertical ? test_and_set(span.y, x) : test_and_set(x, span.y);
+	}
+	span.x0 = x0;
+	span.x1 = x1;
+	return x0 <= x1;
+}
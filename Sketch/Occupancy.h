@@ -0,0 +1,59 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+
+// Largest area an Occupancy will cover: 2MB of bits
+const size_t OCCUPANCY_MAX_PIXELS = 1 << 24;
+
+// Occupancy is one bit per pixel over an area, set as pixels are drawn,
+// so a pixel that's already there can be dropped before it costs a vertex
+// or a fill. Pixels outside the area are never set and never dropped.
+// Only what's drawn after a pixel loses it, so the first shape to draw a
+// pixel keeps it, and removing the newest shape never leaves a hole.
+class Occupancy{
+public:
+	Occupancy();
+
+	// Cover area with every bit clear. False, covering nothing, if area
+	// is empty or bigger than OCCUPANCY_MAX_PIXELS.
+	bool reset(const Rect &area);
+
+	// Was (x, y) set already? It's set either way.
+	bool test_and_set(GLint x, GLint y){
+		GLuint dx = (GLuint)(x - area.x0);
+		GLuint dy = (GLuint)(y - area.y0);
+		if(dx >= (GLuint)(area.x1 - area.x0) || dy >= (GLuint)(area.y1 - area.y0)){
+			return false;
+		}
+		GLuint &word = bits[dy * row_words + (dx >> 5)];
+		GLuint mask = 1u << (dx & 31);
+		bool set = (word & mask) != 0;
+		word |= mask;
+		return set;
+	}
+
+	// Drop pixels already set from point vertices (two floats each)
+	// between first and last, packing the rest down. Returns the new end.
+	GLfloat *filter(GLfloat *first, GLfloat *last);
+
+	// Trim pixels already set off the ends of spans, and drop spans with
+	// nothing left. A run covered only in the middle is kept whole, since
+	// splitting it would take more vertices, not fewer.
+	void filter(vector<Span> &spans);
+
+private:
+	// Set every pixel in a run, or trim set ones off its ends. False if
+	// the whole run was already set.
+	bool trim(Span &span);
+
+	Rect area;
+	size_t row_words;			// 32 bit words per row
+	vector<GLuint> bits;		// Kept between resets, so it's allocated once
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Perf.h"
+
+bool perf_enabled = false;
+FrameStats perf_frame;
+PerfGroup perf_group = PERF_SHAPES;
+
+// Running totals from operator new. They wrap, but only differences
+// over a frame are ever used, and unsigned differences come out right
+// across a wrap. The interlocked calls take LONG, which is the same size.
+static volatile unsigned long allocation_count = 0;
+static volatile unsigned long allocation_bytes = 0;
+static unsigned long frame_count_start = 0;
+static unsigned long frame_bytes_start = 0;
+static double frame_start = 0.0;
+
+// Every new in the program comes through here; new[] and delete[] forward
+// to these by default. Allocations are only counted while the overlay is
+// on, so normal runs don't pay for a locked add on every new.
+void *operator new(size_t size){
+	if(perf_enabled){
+		InterlockedIncrement((volatile LONG*)&allocation_count);
+		InterlockedExchangeAdd((volatile LONG*)&allocation_bytes, (LONG)size);
+	}
+	void *p = malloc(size ? size : 1);
+	if(!p){
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p){
+	free(p);
+}
+
+double perf_now(void){
+	static double period = 0.0;
+	LARGE_INTEGER count;
+	if(period == 0.0){
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		period = 1.0 / frequency.QuadPart;
+	}
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * period;
+}
+
+void perf_begin_frame(void){
+	memset(&perf_frame, 0, sizeof(perf_frame));
+	frame_count_start = allocation_count;
+	frame_bytes_start = allocation_bytes;
+	frame_start = perf_now();
+}
+
+void perf_end_frame(FrameStats &stats){
+	perf_frame.total = perf_now() - frame_start;
+	perf_frame.allocations = allocation_count - frame_count_start;
+	perf_frame.allocated_bytes = allocation_bytes - frame_bytes_start;
+	stats = perf_frame;
+}
+
+FILE *perf_open_trace(const char *path){
+	FILE *trace = 0;
+	if(fopen_s(&trace, path, "w") == 0){
+		fprintf(trace, "total_ms,geometry_ms,upload_ms,draw_ms,hands_ms,hands_built,"
+			"temporary_vertices,shape_vertices,control_vertices,hand_vertices,"
+			"allocations,allocated_bytes,cached_bytes\n");
+	}
+	return trace;
+}
+
+void perf_trace(FILE *trace, const FrameStats &stats){
+	fprintf(trace, "%.3f,%.3f,%.3f,%.3f,%.3f,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+		stats.total * 1e3,
+		stats.phase[PERF_GEOMETRY] * 1e3,
+		stats.phase[PERF_UPLOAD] * 1e3,
+		stats.phase[PERF_DRAW] * 1e3,
+		stats.phase[PERF_HANDS] * 1e3,
+		(unsigned long)stats.hands_built,
+		(unsigned long)stats.vertices[PERF_TEMPORARY],
+		(unsigned long)stats.vertices[PERF_SHAPES],
+		(unsigned long)stats.vertices[PERF_CONTROLS],
+		(unsigned long)stats.vertices[PERF_CLOCK_HANDS],
+		(unsigned long)stats.allocations,
+		(unsigned long)stats.allocated_bytes,
+		(unsigned long)stats.cached_bytes);
+}
@@ -0,0 +1,73 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <cstdio>
+
+#include "Globals.h"
+
+// Where a frame's time goes. Phases don't overlap: upload is taken out of
+// draw, and clock hands are counted apart from other geometry.
+enum PerfPhase { PERF_GEOMETRY, PERF_UPLOAD, PERF_DRAW, PERF_HANDS, PERF_PHASES };
+
+// What's being drawn, for vertex counts
+enum PerfGroup { PERF_TEMPORARY, PERF_SHAPES, PERF_CONTROLS, PERF_CLOCK_HANDS, PERF_GROUPS };
+
+// Everything measured over one frame
+struct FrameStats{
+	double total;					// Seconds from the display callback to the swap
+	double phase[PERF_PHASES];		// Seconds in each phase
+	size_t vertices[PERF_GROUPS];	// Vertices sent to GL
+	size_t hands_built;				// Clock hands rasterized again
+	size_t allocations;				// Calls to operator new
+	size_t allocated_bytes;
+	size_t cached_bytes;			// Store cache size at the end of the frame
+};
+
+// Nothing is timed or counted unless this is set, allocations included
+extern bool perf_enabled;
+
+// The frame being measured, and who its vertices belong to
+extern FrameStats perf_frame;
+extern PerfGroup perf_group;
+
+// Seconds on the high-resolution counter
+double perf_now(void);
+
+// Adds the time it's alive, or until stop, to one phase of perf_frame
+class PerfTimer{
+public:
+	PerfTimer(PerfPhase p): phase(p), running(perf_enabled), start(running ? perf_now() : 0.0) {}
+	~PerfTimer(){
+		stop();
+	}
+
+	void stop(void){
+		if(running){
+			perf_frame.phase[phase] += perf_now() - start;
+			running = false;
+		}
+	}
+
+private:
+	PerfPhase phase;
+	bool running;
+	double start;
+};
+
+// Count vertices sent to GL against perf_group
+inline void perf_vertices(size_t count){
+	if(perf_enabled){
+		perf_frame.vertices[perf_group] += count;
+	}
+}
+
+// Bracket a frame: begin clears perf_frame, end fills in the totals and
+// copies it to stats
+void perf_begin_frame(void);
+void perf_end_frame(FrameStats &stats);
+
+// Machine-readable trace, one CSV line per frame
+FILE *perf_open_trace(const char *path);
+void perf_trace(FILE *trace, const FrameStats &stats);
+
+#endif
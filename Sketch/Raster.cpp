@@ -0,0 +1,416 @@
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Raster.h"
+#include "Simd.h"
+
+// Allocate cache-line aligned rows. The sides are checked before the
+// stride is worked out, as it would overflow for a huge width.
+Raster::Raster(GLint w, GLint h, RasterFormat fmt):
+	width(w),
+	height(h),
+	stride(0),
+	format(fmt),
+	data(0),
+	ink(0)
+{
+	if(w < 1 || h < 1 || w > RASTER_MAX_SIDE || h > RASTER_MAX_SIDE){
+		throw bad_alloc();
+	}
+	stride = (w * fmt + RASTER_ALIGN - 1) / RASTER_ALIGN * RASTER_ALIGN;
+	size_t bytes = (size_t)stride * height;
+	data = (unsigned char*)_aligned_malloc(bytes, RASTER_ALIGN);
+	if(!data){
+		throw bad_alloc();
+	}
+	memset(data, 0, bytes);
+	ink = pack(WHITE);
+}
+
+Raster::~Raster(){
+	_aligned_free(data);
+}
+
+// RGBA32 is stored R, G, B, A in memory regardless of endianness.
+// GRAY8 uses the usual luma weights.
+GLuint Raster::pack(const GLfloat *color) const{
+	if(format == RGBA32){
+		unsigned char bytes[4] = {
+			(unsigned char)(color[0] * 255.0f + 0.5f),
+			(unsigned char)(color[1] * 255.0f + 0.5f),
+			(unsigned char)(color[2] * 255.0f + 0.5f),
+			255
+		};
+		GLuint packed;
+		memcpy(&packed, bytes, sizeof(packed));
+		return packed;
+	}
+	return (GLuint)((0.299f * color[0] + 0.587f * color[1] + 0.114f * color[2]) * 255.0f + 0.5f);
+}
+
+// Fill whole rows at a time
+void Raster::clear(const GLfloat *color){
+	GLuint packed = pack(color);
+	for(GLint y = 0; y < height; ++y){
+		unsigned char *row = data + y * stride;
+		if(format == RGBA32){
+			GLuint *pixel = (GLuint*)row;
+			for(GLint x = 0; x < width; ++x){
+				pixel[x] = packed;
+			}
+		}else{
+			memset(row, packed, width);
+		}
+	}
+}
+
+void Raster::set_color(const GLfloat *color){
+	ink = pack(color);
+}
+
+void Raster::plot(const vector<Point2D> &pixels){
+	for(size_t i = 0; i < pixels.size(); ++i){
+		plot(pixels[i].x, pixels[i].y);
+	}
+}
+
+// Horizontal spans are a contiguous fill; vertical spans step by stride
+void Raster::fill(const Span &span){
+	GLint limit = span.vertical ? height : width;
+	GLint other = span.vertical ? width : height;
+	if((GLuint)span.y >= (GLuint)other){
+		return;
+	}
+	GLint x0 = span.x0 < 0 ? 0 : span.x0;
+	GLint x1 = span.x1 >= limit ? limit - 1 : span.x1;
+	if(x0 > x1){
+		return;
+	}
+	if(span.vertical){
+		unsigned char *pixel = data + x0 * stride + span.y * format;
+		for(GLint i = x0; i <= x1; ++i, pixel += stride){
+			if(format == RGBA32){
+				*(GLuint*)pixel = ink;
+			}else{
+				*pixel = (unsigned char)ink;
+			}
+		}
+	}else if(format == RGBA32){
+		GLuint *pixel = (GLuint*)(data + span.y * stride);
+		for(GLint x = x0; x <= x1; ++x){
+			pixel[x] = ink;
+		}
+	}else{
+		memset(data + span.y * stride + x0, ink, x1 - x0 + 1);
+	}
+}
+
+void Raster::fill(const vector<Span> &spans){
+	for(size_t i = 0; i < spans.size(); ++i){
+		fill(spans[i]);
+	}
+}
+
+// Move a channel c/255 of the way to the ink, rounded to nearest. v / 255
+// is (v + (v >> 8)) >> 8 for v + 128 up to 65535, which is all of them.
+static inline unsigned char mix(unsigned dst, unsigned src, unsigned c){
+	unsigned v = dst * (255 - c) + src * c + 128;
+	return (unsigned char)((v + (v >> 8)) >> 8);
+}
+
+// mix for all four channels of an RGBA pixel at once, two to a 32-bit
+// word in 16-bit lanes. Every lane stays under 65536, so nothing carries
+// into the next.
+static inline GLuint mix_rgba(GLuint dst, GLuint src, unsigned c){
+	const GLuint lanes = 0x00FF00FF;
+	GLuint even = (dst & lanes) * (255 - c) + (src & lanes) * c + 0x00800080;
+	GLuint odd = ((dst >> 8) & lanes) * (255 - c) + ((src >> 8) & lanes) * c + 0x00800080;
+	even = ((even + ((even >> 8) & lanes)) >> 8) & lanes;
+	odd = (odd + ((odd >> 8) & lanes)) & ~lanes;
+	return even | odd;
+}
+
+#ifdef SKETCH_SSE2
+
+// Runs shorter than this aren't worth setting up SSE2 for
+const GLint SSE2_BLEND_MIN = 8;
+
+// Horizontal RGBA runs four pixels at a time, with the same arithmetic as
+// mix in 16-bit lanes, coverage xored with flip. Returns how many pixels
+// it did; the scalar loop finishes the rest.
+static GLint blend_row_sse2(GLuint *pixel, const unsigned char *coverage, GLint count, GLuint ink, unsigned char flip){
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(255);
+	const __m128i half = _mm_set1_epi16(128);
+	const __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((int)ink), zero);
+	const __m128i flips = _mm_set1_epi8((char)flip);
+	GLint i = 0;
+	for(; i + 4 <= count; i += 4){
+		// Spread each pixel's coverage over its four channels
+		GLuint four;
+		memcpy(&four, coverage + i, sizeof(four));
+		__m128i c = _mm_xor_si128(_mm_cvtsi32_si128((int)four), flips);
+		c = _mm_unpacklo_epi8(c, c);
+		c = _mm_unpacklo_epi16(c, c);
+		__m128i dst = _mm_loadu_si128((const __m128i*)(pixel + i));
+		__m128i halves[2];
+		for(int h = 0; h < 2; ++h){
+			__m128i ch = h ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+			__m128i dh = h ? _mm_unpackhi_epi8(dst, zero) : _mm_unpacklo_epi8(dst, zero);
+			__m128i v = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(dh, _mm_sub_epi16(full, ch)), _mm_mullo_epi16(src, ch)), half);
+			halves[h] = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), 8);
+		}
+		_mm_storeu_si128((__m128i*)(pixel + i), _mm_packus_epi16(halves[0], halves[1]));
+	}
+	return i;
+}
+
+#endif
+
+// Same clipping as fill. Anti-aliased runs are mostly a pixel or two
+// long, so RGBA pixels take the packed path and only long rows go to
+// SSE2.
+void Raster::blend_row(GLint y, GLint x0, GLint x1, bool vertical, const unsigned char *coverage, unsigned char flip){
+	GLint limit = vertical ? height : width;
+	GLint other = vertical ? width : height;
+	if((GLuint)y >= (GLuint)other){
+		return;
+	}
+	const unsigned char *c = coverage;
+	if(x0 < 0){
+		c -= x0;
+		x0 = 0;
+	}
+	if(x1 >= limit){
+		x1 = limit - 1;
+	}
+	if(x0 > x1){
+		return;
+	}
+	GLint count = x1 - x0 + 1;
+	GLint step = vertical ? stride : format;
+	unsigned char *pixel = vertical ? data + x0 * stride + y * format : data + y * stride + x0 * format;
+	if(format != RGBA32){
+		for(GLint i = 0; i < count; ++i, pixel += step){
+			*pixel = mix(*pixel, ink, c[i] ^ flip);
+		}
+		return;
+	}
+	GLint i = 0;
+#ifdef SKETCH_SSE2
+	if(!vertical && count >= SSE2_BLEND_MIN && use_sse2()){
+		i = blend_row_sse2((GLuint*)pixel, c, count, ink, flip);
+		pixel += i * step;
+	}
+#endif
+	for(; i < count; ++i, pixel += step){
+		GLuint *p = (GLuint*)pixel;
+		*p = mix_rgba(*p, ink, c[i] ^ flip);
+	}
+}
+
+void Raster::blend(const CoverageSpan &span, const unsigned char *coverage){
+	// A vertical run's pair is the next pixel along each row, so both are
+	// done on the one walk down the rows
+	GLint y = span.y + span.pair;
+	if(span.vertical && span.pair && format == RGBA32 && (GLuint)span.y < (GLuint)width && (GLuint)y < (GLuint)width){
+		GLint x0 = span.x0 < 0 ? 0 : span.x0;
+		GLint x1 = span.x1 >= height ? height - 1 : span.x1;
+		const unsigned char *c = coverage + span.first + (x0 - span.x0);
+		unsigned char *pixel = data + x0 * stride + span.y * format;
+		for(GLint i = 0; i <= x1 - x0; ++i, pixel += stride){
+			GLuint *p = (GLuint*)pixel;
+			p[0] = mix_rgba(p[0], ink, c[i]);
+			p[span.pair] = mix_rgba(p[span.pair], ink, 255 - c[i]);
+		}
+		return;
+	}
+	blend_row(span.y, span.x0, span.x1, span.vertical, coverage + span.first, 0);
+	if(span.pair){
+		blend_row(span.y + span.pair, span.x0, span.x1, span.vertical, coverage + span.first, 255);
+	}
+}
+
+void Raster::blend(const CoverageSpans &runs){
+	if(runs.coverage.empty()){
+		return;
+	}
+	for(size_t i = 0; i < runs.spans.size(); ++i){
+		blend(runs.spans[i], &runs.coverage[0]);
+	}
+}
+
+// Rows are stored top-down, same as image files
+bool Raster::write_ppm(const char *path) const{
+	ofstream out(path, ios::binary);
+	if(!out){
+		return false;
+	}
+	out << (format == RGBA32 ? "P6" : "P5") << "\n" << width << " " << height << "\n255\n";
+	vector<char> line(width * 3);
+	for(GLint y = 0; y < height; ++y){
+		const unsigned char *row = data + y * stride;
+		if(format == RGBA32){
+			for(GLint x = 0; x < width; ++x){
+				line[3 * x] = row[4 * x];
+				line[3 * x + 1] = row[4 * x + 1];
+				line[3 * x + 2] = row[4 * x + 2];
+			}
+			out.write(&line[0], width * 3);
+		}else{
+			out.write((const char*)row, width);
+		}
+	}
+	return out.good();
+}
+
+// PNG helpers. We don't link zlib, so image data goes out as stored
+// (uncompressed) deflate blocks, which every decoder accepts.
+namespace{
+	GLuint crc_table[256];
+	bool crc_ready = false;
+
+	GLuint crc32(const unsigned char *bytes, size_t n, GLuint crc = 0xFFFFFFFF){
+		if(!crc_ready){
+			for(GLuint i = 0; i < 256; ++i){
+				GLuint c = i;
+				for(int k = 0; k < 8; ++k){
+					c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				}
+				crc_table[i] = c;
+			}
+			crc_ready = true;
+		}
+		for(size_t i = 0; i < n; ++i){
+			crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	void put_u32(vector<unsigned char> &out, GLuint value){
+		out.push_back((value >> 24) & 0xFF);
+		out.push_back((value >> 16) & 0xFF);
+		out.push_back((value >> 8) & 0xFF);
+		out.push_back(value & 0xFF);
+	}
+
+	// Length, type, data, CRC of type + data
+	void put_chunk(ofstream &out, const char *type, const vector<unsigned char> &body){
+		vector<unsigned char> chunk;
+		put_u32(chunk, (GLuint)body.size());
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), body.begin(), body.end());
+		put_u32(chunk, crc32(&chunk[4], chunk.size() - 4) ^ 0xFFFFFFFF);
+		out.write((const char*)&chunk[0], chunk.size());
+	}
+
+	// Streams the zlib data as one stored block per IDAT chunk, so a
+	// write holds at most a block of the image however large it is.
+	// Decoders join the IDAT chunks back into a single zlib stream.
+	class IdatWriter{
+	public:
+		// total is the number of raw bytes that will be written
+		IdatWriter(ofstream &out, size_t total): file(out), left(total), a(1), b(0){
+			body.reserve(STORED_MAX + 16);
+			body.push_back(0x78);
+			body.push_back(0x01);
+			begin_block();
+		}
+
+		void write(const unsigned char *bytes, size_t n){
+			while(n){
+				size_t take = n < block_left ? n : block_left;
+				adler(bytes, take);
+				body.insert(body.end(), bytes, bytes + take);
+				bytes += take;
+				n -= take;
+				block_left -= take;
+				left -= take;
+				if(block_left){
+					continue;
+				}
+				if(!left){
+					put_u32(body, (b << 16) | a);
+				}
+				put_chunk(file, "IDAT", body);
+				body.clear();
+				if(left){
+					begin_block();
+				}
+			}
+		}
+
+	private:
+		enum { STORED_MAX = 65535 };
+
+		// Stored block header, marked final for the last one
+		void begin_block(){
+			block_left = left < STORED_MAX ? left : STORED_MAX;
+			body.push_back(block_left == left ? 1 : 0);
+			body.push_back(block_left & 0xFF);
+			body.push_back((block_left >> 8) & 0xFF);
+			body.push_back(~block_left & 0xFF);
+			body.push_back((~block_left >> 8) & 0xFF);
+		}
+
+		// 5552 bytes is the most we can sum before b can overflow
+		void adler(const unsigned char *bytes, size_t n){
+			while(n){
+				size_t run = n < 5552 ? n : 5552;
+				for(size_t i = 0; i < run; ++i){
+					a += bytes[i];
+					b += a;
+				}
+				a %= 65521;
+				b %= 65521;
+				bytes += run;
+				n -= run;
+			}
+		}
+
+		ofstream &file;
+		vector<unsigned char> body;
+		size_t left;		// Raw bytes still to come
+		size_t block_left;	// Raw bytes still to come in this block
+		GLuint a;
+		GLuint b;
+	};
+}
+
+bool Raster::write_png(const char *path) const{
+	ofstream out(path, ios::binary);
+	if(!out){
+		return false;
+	}
+	static const unsigned char signature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+	out.write((const char*)signature, sizeof(signature));
+
+	// 8-bit grayscale or 8-bit RGBA, no interlacing
+	vector<unsigned char> header;
+	put_u32(header, width);
+	put_u32(header, height);
+	header.push_back(8);
+	header.push_back(format == RGBA32 ? 6 : 0);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	put_chunk(out, "IHDR", header);
+
+	// Scanlines, each prefixed with filter type 0
+	size_t row_bytes = width * format;
+	IdatWriter idat(out, (row_bytes + 1) * height);
+	static const unsigned char filter = 0;
+	for(GLint y = 0; y < height && out; ++y){
+		idat.write(&filter, 1);
+		idat.write(data + y * stride, row_bytes);
+	}
+
+	put_chunk(out, "IEND", vector<unsigned char>());
+	return out.good();
+}
@@ -0,0 +1,93 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Coverage.h"
+
+// Bytes per pixel for each raster layout
+enum RasterFormat { GRAY8 = 1, RGBA32 = 4 };
+
+// Rows are padded out to a whole number of cache lines
+const GLint RASTER_ALIGN = 64;
+
+// Widest and tallest a Raster can be. Pixel offsets are GLints, and an
+// RGBA32 raster this size on a side is 1GB.
+const GLint RASTER_MAX_SIDE = 16384;
+
+// Raster is a CPU framebuffer. It takes the same pixels that VertexBuffer
+// hands to GL, but needs no window or context, so scenes can be rendered
+// and exported headlessly. Row 0 is the top row, just like the window
+// coordinates the kernels produce.
+class Raster{
+public:
+	// Sides from 1 to RASTER_MAX_SIDE. Throws bad_alloc, like new, for
+	// a side out of that range or if there isn't the memory.
+	Raster(GLint w, GLint h, RasterFormat fmt);
+	~Raster();
+
+	// Fill every pixel with color
+	void clear(const GLfloat *color);
+
+	// Color used by plot (works like glColor3fv)
+	void set_color(const GLfloat *color);
+
+	// Write a single pixel. Anything off the raster is dropped.
+	void plot(GLint x, GLint y){
+		if((GLuint)x < (GLuint)width && (GLuint)y < (GLuint)height){
+			if(format == RGBA32){
+				((GLuint*)(data + y * stride))[x] = ink;
+			}else{
+				data[y * stride + x] = (unsigned char)ink;
+			}
+		}
+	}
+
+	// Write every pixel in a vector
+	void plot(const vector<Point2D> &pixels);
+
+	// Write a run of pixels, clipped to the raster
+	void fill(const Span &span);
+
+	// Write every span in a vector
+	void fill(const vector<Span> &spans);
+
+	// Blend a run of anti-aliased pixels, and the row paired with it, over
+	// the raster in the current color, clipped to it. Its coverage is at
+	// coverage + span.first.
+	void blend(const CoverageSpan &span, const unsigned char *coverage);
+
+	// Blend every run
+	void blend(const CoverageSpans &runs);
+
+	// Dump to binary PPM (or PGM for GRAY8)
+	bool write_ppm(const char *path) const;
+
+	// Dump to PNG
+	bool write_png(const char *path) const;
+
+	GLint width;
+	GLint height;
+	GLint stride;				// Bytes per row, multiple of RASTER_ALIGN
+	RasterFormat format;
+	unsigned char *data;		// RASTER_ALIGN-aligned pixel rows
+
+private:
+	// Pack a color for the current format
+	GLuint pack(const GLfloat *color) const;
+
+	// One row of a run, with each byte xored with flip (0, or 255 for
+	// the paired row)
+	void blend_row(GLint y, GLint x0, GLint x1, bool vertical, const unsigned char *coverage, unsigned char flip);
+
+	GLuint ink;					// Packed plot color
+
+	// Rasters own their memory; no copying
+	Raster(Raster const&);
+	void operator=(Raster const&);
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Shape.h"
+#include "SceneFile.h"
+
+// Points each kind of shape uses
+static size_t point_count(ShapeKind kind){
+	return kind == SHAPE_LINE ? 2 : kind == SHAPE_CURVE ? 4 : 1;
+}
+
+// Shape keywords in the text form, indexed by ShapeKind
+static const char *KIND_NAMES[] = {"line", "circle", "curve", "clock"};
+const GLint KIND_COUNT = sizeof(KIND_NAMES) / sizeof(char*);
+
+// Ends a filled shape in the text form
+static const char FILL_NAME[] = "fill";
+
+SceneMap::SceneMap(const char *path):
+	file(INVALID_HANDLE_VALUE),
+	mapping(0),
+	view(0),
+	count(0),
+	record_size(0),
+	valid(false)
+{
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		return;
+	}
+	LARGE_INTEGER bytes;
+	if(!GetFileSizeEx(file, &bytes) || bytes.QuadPart < (long long)sizeof(SceneHeader)){
+		return;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(!mapping){
+		return;
+	}
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!view){
+		return;
+	}
+
+	// Trust nothing past what the file actually holds
+	const SceneHeader *header = (const SceneHeader*)view;
+	if(memcmp(header->magic, SCENE_MAGIC, 4) != 0){
+		return;
+	}
+	bool current = header->version == SCENE_VERSION && header->record_size == sizeof(ShapeRecord);
+	bool old = header->version == SCENE_VERSION_1 && header->record_size == SCENE_RECORD_SIZE_1;
+	if(!current && !old){
+		return;
+	}
+	if((unsigned long long)header->count * header->record_size > (unsigned long long)bytes.QuadPart - sizeof(SceneHeader)){
+		return;
+	}
+	count = header->count;
+	record_size = header->record_size;
+	valid = true;
+}
+
+SceneMap::~SceneMap(){
+	if(view){
+		UnmapViewOfFile(view);
+	}
+	if(mapping){
+		CloseHandle(mapping);
+	}
+	if(file != INVALID_HANDLE_VALUE){
+		CloseHandle(file);
+	}
+}
+
+bool SceneMap::ok(void) const{
+	return valid;
+}
+
+size_t SceneMap::size(void) const{
+	return count;
+}
+
+void SceneMap::record(size_t i, ShapeRecord &out) const{
+	memset(&out, 0, sizeof(out));
+	memcpy(&out, (const char*)((const SceneHeader*)view + 1) + i * record_size, record_size);
+}
+
+bool write_scene(const char *path, const Scene &scene){
+	ofstream out(path, ios::binary);
+	if(!out){
+		return false;
+	}
+	SceneHeader header;
+	memcpy(header.magic, SCENE_MAGIC, 4);
+	header.version = SCENE_VERSION;
+	header.count = (GLuint)scene.size();
+	header.record_size = sizeof(ShapeRecord);
+	out.write((const char*)&header, sizeof(header));
+
+	// Records go out in batches rather than one write each
+	vector<ShapeRecord> batch;
+	batch.reserve(4096);
+	for(size_t i = 0; i < scene.size(); ++i){
+		const Shape &shape = scene[i];
+		ShapeRecord record;
+		memset(&record, 0, sizeof(record));
+		record.kind = shape.kind;
+		record.radius = shape.radius;
+		record.filled = shape.filled ? 1 : 0;
+		for(size_t p = 0; p < point_count(shape.kind); ++p){
+			record.points[2 * p] = shape.points[p].x;
+			record.points[2 * p + 1] = shape.points[p].y;
+		}
+		batch.push_back(record);
+		if(batch.size() == batch.capacity() || i + 1 == scene.size()){
+			out.write((const char*)&batch[0], batch.size() * sizeof(ShapeRecord));
+			batch.clear();
+		}
+	}
+	return out.good();
+}
+
+bool write_scene_text(const char *path, const Scene &scene){
+	ofstream out(path);
+	if(!out){
+		return false;
+	}
+	out << "# sketch scene, " << scene.size() << " shapes\n";
+	for(size_t i = 0; i < scene.size(); ++i){
+		const Shape &shape = scene[i];
+		out << KIND_NAMES[shape.kind];
+		for(size_t p = 0; p < point_count(shape.kind); ++p){
+			out << " " << shape.points[p].x << " " << shape.points[p].y;
+		}
+		if(shape.kind == SHAPE_CIRCLE || shape.kind == SHAPE_CLOCK){
+			out << " " << shape.radius;
+		}
+		if(shape.filled){
+			out << " " << FILL_NAME;
+		}
+		out << "\n";
+	}
+	return out.good();
+}
+
+// Lines are never filled
+static bool fill_ok(GLint kind, GLint filled){
+	return filled == 0 || (filled == 1 && kind != SHAPE_LINE);
+}
+
+// Records are checked as they're copied out of the mapping; one bad kind,
+// negative radius or fill flag rejects the file
+static bool read_scene_binary(const char *path, Scene &scene){
+	SceneMap map(path);
+	if(!map.ok()){
+		return false;
+	}
+	vector<Shape> shapes(map.size());
+	for(size_t i = 0; i < map.size(); ++i){
+		ShapeRecord record;
+		map.record(i, record);
+		if(record.kind < 0 || record.kind >= KIND_COUNT || record.radius < 0 || !fill_ok(record.kind, record.filled)){
+			return false;
+		}
+		Shape &shape = shapes[i];
+		shape.kind = (ShapeKind)record.kind;
+		shape.radius = record.radius;
+		shape.filled = record.filled != 0;
+		for(size_t p = 0; p < 4; ++p){
+			shape.points[p] = Point2D(record.points[2 * p], record.points[2 * p + 1]);
+		}
+	}
+	scene.assign(shapes);
+	return true;
+}
+
+bool parse_shape(const string &name, istream &fields, Shape &shape){
+	GLint kind = 0;
+	while(kind < KIND_COUNT && name != KIND_NAMES[kind]){
+		++kind;
+	}
+	if(kind == KIND_COUNT){
+		return false;
+	}
+	shape = Shape();
+	shape.kind = (ShapeKind)kind;
+	for(size_t p = 0; p < point_count(shape.kind); ++p){
+		fields >> shape.points[p].x >> shape.points[p].y;
+	}
+	if(shape.kind == SHAPE_CIRCLE || shape.kind == SHAPE_CLOCK){
+		fields >> shape.radius;
+	}
+	if(fields.fail() || shape.radius < 0){
+		return false;
+	}
+	string word;
+	if(fields >> word){
+		if(word != FILL_NAME || !fill_ok(shape.kind, 1)){
+			return false;
+		}
+		shape.filled = true;
+	}
+	return true;
+}
+
+static bool read_scene_text(const char *path, Scene &scene){
+	ifstream in(path);
+	if(!in){
+		return false;
+	}
+	vector<Shape> shapes;
+	string line;
+	while(getline(in, line)){
+		istringstream fields(line);
+		string name;
+		if(!(fields >> name) || name[0] == '#'){
+			continue;
+		}
+		Shape shape;
+		if(!parse_shape(name, fields, shape)){
+			return false;
+		}
+		shapes.push_back(shape);
+	}
+	scene.assign(shapes);
+	return true;
+}
+
+bool read_scene(const char *path, Scene &scene){
+	char magic[4] = {0};
+	ifstream probe(path, ios::binary);
+	if(!probe){
+		return false;
+	}
+	probe.read(magic, 4);
+	probe.close();
+	if(memcmp(magic, SCENE_MAGIC, 4) == 0){
+		return read_scene_binary(path, scene);
+	}
+	return read_scene_text(path, scene);
+}
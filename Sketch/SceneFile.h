@@ -0,0 +1,88 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <istream>
+#include <string>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Shape.h"
+
+// Binary scene files are a SceneHeader followed by count ShapeRecords,
+// little-endian as x86 writes them. Shapes are stored as parameters, not
+// pixels, so a line is 44 bytes however long it is.
+const char SCENE_MAGIC[4] = {'S', 'K', 'S', 'C'};
+const GLuint SCENE_VERSION = 2;
+
+// Version 1 files are still read. Their records stop before filled.
+const GLuint SCENE_VERSION_1 = 1;
+const GLuint SCENE_RECORD_SIZE_1 = 40;
+
+struct SceneHeader{
+	char magic[4];			// SCENE_MAGIC
+	GLuint version;			// SCENE_VERSION
+	GLuint count;			// Number of records
+	GLuint record_size;		// sizeof(ShapeRecord) when written
+};
+
+// One Shape with fixed-size fields
+struct ShapeRecord{
+	GLint kind;				// ShapeKind
+	GLint radius;
+	GLint points[8];		// x, y pairs
+	GLint filled;			// 1 if filled, else 0
+};
+
+// SceneMap maps a binary scene file read-only and checks its header.
+// Records are copied straight out of the page cache with no read buffers
+// or decoding. Loading still copies each one once, into the Scene, since
+// the sketch has to be editable and the view is read-only.
+class SceneMap{
+public:
+	SceneMap(const char *path);
+	~SceneMap();
+
+	// Did the file open, map, and check out?
+	bool ok(void) const;
+
+	size_t size(void) const;
+
+	// Copy out record i. Fields an older version doesn't have are 0.
+	void record(size_t i, ShapeRecord &out) const;
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const void *view;
+	size_t count;
+	size_t record_size;		// As written, which depends on the version
+	bool valid;
+
+	// Maps own handles; no copying
+	SceneMap(SceneMap const&);
+	void operator=(SceneMap const&);
+};
+
+// Text scene files have one shape per line, for reading and diffing:
+//     line x0 y0 x1 y1
+//     circle x y radius
+//     curve x0 y0 x1 y1 x2 y2 x3 y3
+//     clock x y radius
+// Circles, clocks and curves are filled when they end with the word fill.
+// Blank lines and lines starting with # are skipped.
+
+// Read one shape in the text form, given its keyword (already taken off
+// the front of the line) and the rest of the line. False if the keyword
+// isn't a shape or the numbers don't read.
+bool parse_shape(const string &name, istream &fields, Shape &shape);
+
+// Write scene in either form
+bool write_scene(const char *path, const Scene &scene);
+bool write_scene_text(const char *path, const Scene &scene);
+
+// Replace scene with a file's shapes. Binary and text files are told
+// apart by the magic number. On failure scene is left alone.
+bool read_scene(const char *path, Scene &scene);
+
+#endif
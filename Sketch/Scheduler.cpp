@@ -0,0 +1,65 @@
+#include <sys/timeb.h>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Scheduler.h"
+
+Scheduler::Scheduler():
+	region(0, 0, DEFAULT_WIDTH, DEFAULT_HEIGHT),
+	canvas(0, 0, DEFAULT_WIDTH, DEFAULT_HEIGHT),
+	tick_pending(false)
+{
+}
+
+// Everything on the new canvas needs drawing
+void Scheduler::resize(GLint width, GLint height){
+	canvas = Rect(0, 0, width, height);
+	invalidate();
+}
+
+void Scheduler::invalidate(void){
+	invalidate(canvas);
+}
+
+// Only post a redisplay on the clean-to-dirty transition; GLUT would
+// coalesce them anyway, but this keeps motion events cheap. Anything off
+// the canvas is dropped, so off-screen changes post nothing at all.
+void Scheduler::invalidate(const Rect &area){
+	Rect visible = area.intersection(canvas);
+	if(visible.empty()){
+		return;
+	}
+	if(region.empty()){
+		glutPostRedisplay();
+	}
+	region.unite(visible);
+}
+
+const Rect &Scheduler::dirty(void) const{
+	return region;
+}
+
+void Scheduler::drawn(void){
+	region = Rect();
+}
+
+// Line ticks up with the wall clock's second boundary so the second hand
+// moves when the second actually changes, not up to a second late.
+void Scheduler::schedule_tick(bool smooth, void (*callback)(int)){
+	if(tick_pending){
+		return;
+	}
+	unsigned int delay = SMOOTH_TICK_MS;
+	if(!smooth){
+		_timeb now;
+		_ftime(&now);
+		delay = 1000 - now.millitm;
+	}
+	glutTimerFunc(delay, callback, 0);
+	tick_pending = true;
+}
+
+void Scheduler::tick(void){
+	tick_pending = false;
+}
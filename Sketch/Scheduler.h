@@ -0,0 +1,44 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Globals.h"
+
+// Scheduler decides when the window needs repainting. Nothing is redrawn
+// unless something invalidated part of the screen: input events, or a
+// clock tick once a second (or every SMOOTH_TICK_MS in smooth mode).
+// With nothing dirty and no clocks on screen, the app sits idle in
+// glutMainLoop.
+class Scheduler{
+public:
+	Scheduler();
+
+	// Call when the window changes size
+	void resize(GLint width, GLint height);
+
+	// Mark the whole window dirty
+	void invalidate(void);
+
+	// Mark part of the window dirty
+	void invalidate(const Rect &area);
+
+	// Everything invalidated since the last frame
+	const Rect &dirty(void) const;
+
+	// Call once a frame has been drawn
+	void drawn(void);
+
+	// Arm a timer for the next clock tick if one isn't pending. The
+	// callback fires on the next whole second, or after SMOOTH_TICK_MS
+	// when smooth is set.
+	void schedule_tick(bool smooth, void (*callback)(int));
+
+	// Call from the timer callback
+	void tick(void);
+
+private:
+	Rect region;		// Dirty area, in window coordinates
+	Rect canvas;		// The whole window
+	bool tick_pending;	// Is a timer armed?
+};
+
+#endif
@@ -0,0 +1,296 @@
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Shape.h"
+
+static bool pixel_before(const Point2D &a, const Point2D &b){
+	return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+// Take pixels out of the spans from first on, which have to be one
+// horizontal span a row, top to bottom, like a disc's
+static void cut_pixels(vector<Span> &spans, size_t first, vector<Point2D> &pixels){
+	sort(pixels.begin(), pixels.end(), pixel_before);
+	vector<Span> rows(spans.begin() + first, spans.end());
+	spans.resize(first);
+	size_t p = 0;
+	for(size_t i = 0; i < rows.size(); ++i){
+		const Span &row = rows[i];
+		GLint x = row.x0;
+		for(; p < pixels.size() && pixels[p].y < row.y; ++p){
+		}
+		for(; p < pixels.size() && pixels[p].y == row.y; ++p){
+			if(pixels[p].x >= x && pixels[p].x <= row.x1){
+				if(pixels[p].x > x){
+					spans.push_back(Span(row.y, x, pixels[p].x - 1, false));
+				}
+				x = pixels[p].x + 1;
+			}
+		}
+		if(x <= row.x1){
+			spans.push_back(Span(row.y, x, row.x1, false));
+		}
+	}
+}
+
+// Same kernels DrawContext uses when the shape is saved. Curves only
+// come as pixels, so they're merged back into runs.
+void shape_spans(const Shape &shape, TimeAngle &ta, vector<Span> &spans){
+	vector<Point2D> points;
+	vector<Point2D> pixels;
+	size_t face = spans.size();
+	switch(shape.kind){
+	case SHAPE_LINE:
+		make_line_spans(shape.points[0], shape.points[1], spans);
+		break;
+	case SHAPE_CIRCLE:
+		if(shape.filled){
+			make_disc_spans(shape.points[0], shape.radius, spans);
+		}else{
+			make_circle_spans(shape.points[0], shape.radius, spans);
+		}
+		break;
+	case SHAPE_CURVE:
+		points.assign(shape.points, shape.points + 4);
+		if(shape.filled){
+			make_closed_path_spans(points, 3, SHAPE_FILL_RULE, spans);
+		}else{
+			make_curve(points, pixels);
+			pixel_spans(pixels, spans);
+		}
+		break;
+	case SHAPE_CLOCK:
+		if(shape.filled){
+			make_disc_spans(shape.points[0], shape.radius, spans);
+			make_hands(shape.points[0], shape.radius, pixels, ta);
+			cut_pixels(spans, face, pixels);
+		}else{
+			// Same end points as make_hands
+			Point2D center = shape.points[0];
+			GLint radius = shape.radius;
+			SubpixelPoint from = to_coord<Fixed24_8Coords>(center);
+			make_circle_spans(center, radius, spans);
+			make_line_spans(from, hand_end(center, radius, ta.hour_cos, ta.hour_sin), spans);
+			make_line_spans(from, hand_end(center, radius, ta.min_cos, ta.min_sin), spans);
+			make_line_spans(from, hand_end(center, radius, ta.sec_cos, ta.sec_sin), spans);
+		}
+		break;
+	}
+}
+
+void control_spans(const Shape &shape, vector<Span> &spans){
+	if(shape.kind != SHAPE_CURVE){
+		return;
+	}
+	for(int i = 0; i < 3; ++i){
+		make_line_spans(shape.points[i], shape.points[i + 1], spans);
+	}
+}
+
+// Runs for spans at full coverage. They all share one row of bytes, as
+// long as the longest.
+static void solid_coverage(const vector<Span> &spans, CoverageSpans &runs){
+	GLint longest = 0;
+	for(size_t i = 0; i < spans.size(); ++i){
+		longest = spans[i].x1 - spans[i].x0 + 1 > longest ? spans[i].x1 - spans[i].x0 + 1 : longest;
+	}
+	GLuint first = (GLuint)runs.coverage.size();
+	runs.coverage.resize(first + longest, 255);
+	for(size_t i = 0; i < spans.size(); ++i){
+		const Span &s = spans[i];
+		runs.spans.push_back(CoverageSpan(s.y, s.x0, s.x1, s.vertical, 0, first));
+	}
+}
+
+// Filled shapes are their hard spans with the outline smoothed over the
+// edge. Clock hands stay cut out of the face.
+static void fill_coverage(const Shape &shape, TimeAngle &ta, CoverageSpans &runs){
+	vector<Span> spans;
+	shape_spans(shape, ta, spans);
+	solid_coverage(spans, runs);
+	if(shape.kind == SHAPE_CURVE){
+		vector<SubpixelPoint> polygon;
+		flatten_curve(shape.points, 4, CURVE_FLATNESS, polygon);
+		polygon.push_back(polygon[0]);
+		make_polyline_aa(polygon, runs);
+	}else{
+		make_circle_aa(shape.points[0], shape.radius, runs);
+	}
+}
+
+void shape_coverage(const Shape &shape, TimeAngle &ta, CoverageSpans &runs){
+	vector<Point2D> points;
+	if(shape.filled){
+		fill_coverage(shape, ta, runs);
+		return;
+	}
+	switch(shape.kind){
+	case SHAPE_LINE:
+		make_line_aa(shape.points[0], shape.points[1], runs);
+		break;
+	case SHAPE_CIRCLE:
+		make_circle_aa(shape.points[0], shape.radius, runs);
+		break;
+	case SHAPE_CURVE:
+		points.assign(shape.points, shape.points + 4);
+		make_curve_aa(points, runs);
+		break;
+	case SHAPE_CLOCK:
+		make_circle_aa(shape.points[0], shape.radius, runs);
+		make_hands_aa(shape.points[0], shape.radius, runs, ta);
+		break;
+	}
+}
+
+void control_coverage(const Shape &shape, CoverageSpans &runs){
+	if(shape.kind != SHAPE_CURVE){
+		return;
+	}
+	// One polyline, so the corners aren't covered twice
+	vector<SubpixelPoint> polygon;
+	for(int i = 0; i < 4; ++i){
+		polygon.push_back(to_coord<Fixed24_8Coords>(shape.points[i]));
+	}
+	make_polyline_aa(polygon, runs);
+}
+
+void pixel_spans(const vector<Point2D> &pixels, vector<Span> &spans){
+	for(size_t i = 0; i < pixels.size(); ++i){
+		const Point2D &p = pixels[i];
+		if(i && p.y == spans.back().y && p.x == spans.back().x1 + 1 && !spans.back().vertical){
+			spans.back().x1 = p.x;
+		}else{
+			spans.push_back(Span(p.y, p.x, p.x, false));
+		}
+	}
+}
+
+Rect shape_bounds(const Shape &shape){
+	Rect bounds;
+	GLint r = shape.radius;
+	switch(shape.kind){
+	case SHAPE_LINE:
+		for(int i = 0; i < 2; ++i){
+			bounds.unite(Rect(shape.points[i].x, shape.points[i].y, shape.points[i].x + 1, shape.points[i].y + 1));
+		}
+		break;
+	case SHAPE_CIRCLE:
+	case SHAPE_CLOCK:
+		bounds = Rect(shape.points[0].x - r, shape.points[0].y - r, shape.points[0].x + r + 1, shape.points[0].y + r + 1);
+		break;
+	case SHAPE_CURVE:
+		for(int i = 0; i < 4; ++i){
+			bounds.unite(Rect(shape.points[i].x, shape.points[i].y, shape.points[i].x + 1, shape.points[i].y + 1));
+		}
+		break;
+	}
+	return bounds;
+}
+
+Shape scale_shape(const Shape &shape, GLfloat scale){
+	Shape scaled(shape);
+	for(int i = 0; i < 4; ++i){
+		scaled.points[i] = Point2D((GLint)floor(shape.points[i].x * scale + 0.5f), (GLint)floor(shape.points[i].y * scale + 0.5f));
+	}
+	scaled.radius = (GLint)floor(shape.radius * scale + 0.5f);
+	return scaled;
+}
+
+// Squared distance from p to the segment a-b
+static GLfloat segment_distance2(const Point2D &a, const Point2D &b, const Point2D &p){
+	GLfloat dx = (GLfloat)(b.x - a.x), dy = (GLfloat)(b.y - a.y);
+	GLfloat px = (GLfloat)(p.x - a.x), py = (GLfloat)(p.y - a.y);
+	GLfloat length2 = dx * dx + dy * dy;
+	GLfloat t = length2 > 0.0f ? (px * dx + py * dy) / length2 : 0.0f;
+	t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+	px -= t * dx;
+	py -= t * dy;
+	return px * px + py * py;
+}
+
+// Is p inside the closed polyline by rule? Same crossings as
+// make_polygon_spans, counted to the right of p.
+static bool polygon_contains(const vector<Point2D> &polygon, FillRule rule, const Point2D &p){
+	GLint crossings = 0;
+	GLint winding = 0;
+	for(size_t i = 0; i < polygon.size(); ++i){
+		const Point2D &a = polygon[i];
+		const Point2D &b = polygon[i + 1 < polygon.size() ? i + 1 : 0];
+		if((a.y <= p.y) == (b.y <= p.y)){
+			continue;
+		}
+		double x = a.x + (double)(p.y - a.y) * (b.x - a.x) / (b.y - a.y);
+		if(x > p.x){
+			crossings += 1;
+			winding += b.y > a.y ? 1 : -1;
+		}
+	}
+	return rule == FILL_EVEN_ODD ? (crossings & 1) != 0 : winding != 0;
+}
+
+bool shape_hit(const Shape &shape, const Point2D &p, GLint tolerance){
+	GLfloat reach2 = (GLfloat)tolerance * tolerance;
+	GLfloat dx = (GLfloat)(p.x - shape.points[0].x), dy = (GLfloat)(p.y - shape.points[0].y);
+	GLfloat distance = sqrt(dx * dx + dy * dy);
+	vector<Point2D> polyline;
+	switch(shape.kind){
+	case SHAPE_LINE:
+		return segment_distance2(shape.points[0], shape.points[1], p) <= reach2;
+	case SHAPE_CIRCLE:
+		return shape.filled ? distance <= shape.radius + tolerance : fabs(distance - shape.radius) <= tolerance;
+	case SHAPE_CLOCK:
+		return distance <= shape.radius + tolerance;
+	case SHAPE_CURVE:
+		flatten_curve(shape.points, 4, CURVE_FLATNESS, polyline);
+		if(shape.filled){
+			if(polygon_contains(polyline, SHAPE_FILL_RULE, p)){
+				return true;
+			}
+			polyline.push_back(polyline[0]);
+		}
+		for(size_t i = 1; i < polyline.size(); ++i){
+			if(segment_distance2(polyline[i - 1], polyline[i], p) <= reach2){
+				return true;
+			}
+		}
+		return polyline.size() == 1 && segment_distance2(polyline[0], polyline[0], p) <= reach2;
+	}
+	return false;
+}
+
+void Scene::push(const Shape &shape){
+	shapes.push_back(shape);
+}
+
+void Scene::insert(size_t i, const Shape &shape){
+	shapes.insert(shapes.begin() + i, shape);
+}
+
+void Scene::erase(size_t i){
+	shapes.erase(shapes.begin() + i);
+}
+
+void Scene::clear(void){
+	shapes.clear();
+}
+
+void Scene::assign(vector<Shape> &replacement){
+	shapes.swap(replacement);
+	replacement.clear();
+}
+
+void Scene::swap(Scene &other){
+	shapes.swap(other.shapes);
+}
+
+size_t Scene::size(void) const{
+	return shapes.size();
+}
+
+const Shape &Scene::operator[](size_t i) const{
+	return shapes[i];
+}
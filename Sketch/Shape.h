@@ -0,0 +1,91 @@
+#ifndef SHAPE_H
+#define SHAPE_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Coverage.h"
+
+// A filled curve is one cubic closed by a straight line, which never
+// winds round anything twice, so the rules agree; this is the one used
+const FillRule SHAPE_FILL_RULE = FILL_NON_ZERO;
+
+// Kinds of saved shape
+enum ShapeKind { SHAPE_LINE, SHAPE_CIRCLE, SHAPE_CURVE, SHAPE_CLOCK };
+
+// Shape is what a saved shape was drawn from: its parameters, not its
+// pixels, so it can be drawn again somewhere else (another thread, a
+// file, a bigger raster).
+struct Shape{
+	ShapeKind kind;
+	Point2D points[4];		// Line: both ends. Circle, clock: center. Curve: control points.
+	GLint radius;			// Circles and clocks only
+	bool filled;			// Circles, clocks and curves (closed end to end) can be filled
+
+	// Constructors
+	Shape(): kind(SHAPE_LINE), radius(0), filled(false) {}
+	Shape(ShapeKind k, const Point2D *pts, size_t count, GLint r, bool f = false): kind(k), radius(r), filled(f) {
+		for(size_t i = 0; i < count && i < 4; ++i){
+			points[i] = pts[i];
+		}
+	}
+};
+
+// Spans covering a shape, the same pixels its Layer draws. Clocks need
+// the time for their hands, which are cut out of filled faces.
+void shape_spans(const Shape &shape, TimeAngle &ta, vector<Span> &spans);
+
+// Spans covering a curve's control polygon (nothing for other shapes)
+void control_spans(const Shape &shape, vector<Span> &spans);
+
+// Anti-aliased runs for a shape, and for a curve's control polygon
+void shape_coverage(const Shape &shape, TimeAngle &ta, CoverageSpans &runs);
+void control_coverage(const Shape &shape, CoverageSpans &runs);
+
+// Merge runs of horizontally adjacent pixels into spans
+void pixel_spans(const vector<Point2D> &pixels, vector<Span> &spans);
+
+// Every pixel the shape (or its control polygon) can touch. Curves stay
+// inside the hull of their control points and clock hands inside the face.
+Rect shape_bounds(const Shape &shape);
+
+// The same shape drawn scale times bigger, rounded to whole pixels
+Shape scale_shape(const Shape &shape, GLfloat scale);
+
+// Is p within tolerance pixels of the shape's outline, or inside it if
+// it's filled? Anywhere on a clock's face counts, since its hands move.
+bool shape_hit(const Shape &shape, const Point2D &p, GLint tolerance);
+
+// Scene is every saved shape in the order it was drawn
+class Scene{
+public:
+	// Append one shape
+	void push(const Shape &shape);
+
+	// Put a shape back at i, moving later shapes up one
+	void insert(size_t i, const Shape &shape);
+
+	// Remove one shape
+	void erase(size_t i);
+
+	// Remove every shape
+	void clear(void);
+
+	// Replace every shape (shapes is left empty)
+	void assign(vector<Shape> &shapes);
+
+	// Trade shapes with another scene without copying
+	void swap(Scene &other);
+
+	// Number of shapes
+	size_t size(void) const;
+
+	const Shape &operator[](size_t i) const;
+
+private:
+	vector<Shape> shapes;
+};
+
+#endif
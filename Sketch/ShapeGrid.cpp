@@ -0,0 +1,170 @@
+#include <vector>
+#include <map>
+#include <algorithm>
+
+using namespace std;
+
+#include "Globals.h"
+#include "ShapeGrid.h"
+
+// Division that rounds toward negative infinity, so cells to the left of
+// and above the origin don't share cell 0
+static GLint cell_floor(GLint v, GLint size){
+	return v >= 0 ? v / size : -((-v + size - 1) / size);
+}
+
+Rect ShapeGrid::cells_of(const Rect &bounds, size_t level) const{
+	GLint size = GRID_CELL << (2 * level);
+	return Rect(cell_floor(bounds.x0, size), cell_floor(bounds.y0, size), cell_floor(bounds.x1 - 1, size) + 1, cell_floor(bounds.y1 - 1, size) + 1);
+}
+
+size_t ShapeGrid::level_of(const Rect &bounds) const{
+	for(size_t level = 0; level < GRID_LEVELS; ++level){
+		Rect c = cells_of(bounds, level);
+		if((size_t)(c.x1 - c.x0) * (size_t)(c.y1 - c.y0) <= GRID_MAX_CELLS){
+			return level;
+		}
+	}
+	return GRID_LEVELS;
+}
+
+void ShapeGrid::push(const Rect &bounds){
+	insert(rects.size(), bounds);
+}
+
+// Entries are kept sorted in every cell. Appending, the usual case, never
+// has to renumber or search.
+void ShapeGrid::insert(size_t i, const Rect &bounds){
+	if(i < rects.size()){
+		renumber(i, 1);
+	}
+	rects.insert(rects.begin() + i, bounds);
+	if(bounds.empty()){
+		return;
+	}
+	size_t level = level_of(bounds);
+	if(level == GRID_LEVELS){
+		large.insert(lower_bound(large.begin(), large.end(), i), i);
+		return;
+	}
+	Rect c = cells_of(bounds, level);
+	for(GLint y = c.y0; y < c.y1; ++y){
+		for(GLint x = c.x0; x < c.x1; ++x){
+			vector<size_t> &entries = levels[level][Cell(x, y)];
+			entries.insert(lower_bound(entries.begin(), entries.end(), i), i);
+		}
+	}
+}
+
+// Renumbering touches every entry, which is fine for the odd insert or
+// erase but would not be for a whole batch of them
+void ShapeGrid::renumber(size_t first, int delta){
+	for(size_t l = 0; l < GRID_LEVELS; ++l){
+		for(Level::iterator cell = levels[l].begin(); cell != levels[l].end(); ++cell){
+			vector<size_t> &entries = cell->second;
+			for(vector<size_t>::iterator e = lower_bound(entries.begin(), entries.end(), first); e != entries.end(); ++e){
+				*e += delta;
+			}
+		}
+	}
+	for(vector<size_t>::iterator e = lower_bound(large.begin(), large.end(), first); e != large.end(); ++e){
+		*e += delta;
+	}
+}
+
+void ShapeGrid::erase(size_t i){
+	size_t level = rects[i].empty() ? GRID_LEVELS + 1 : level_of(rects[i]);
+	if(level < GRID_LEVELS){
+		Rect c = cells_of(rects[i], level);
+		for(GLint y = c.y0; y < c.y1; ++y){
+			for(GLint x = c.x0; x < c.x1; ++x){
+				Level::iterator cell = levels[level].find(Cell(x, y));
+				cell->second.erase(lower_bound(cell->second.begin(), cell->second.end(), i));
+				if(cell->second.empty()){
+					levels[level].erase(cell);
+				}
+			}
+		}
+	}else if(level == GRID_LEVELS){
+		large.erase(lower_bound(large.begin(), large.end(), i));
+	}
+	rects.erase(rects.begin() + i);
+	if(i < rects.size()){
+		renumber(i + 1, -1);
+	}
+}
+
+void ShapeGrid::clear(void){
+	for(size_t l = 0; l < GRID_LEVELS; ++l){
+		levels[l].clear();
+	}
+	large.clear();
+	rects.clear();
+}
+
+void ShapeGrid::swap(ShapeGrid &other){
+	for(size_t l = 0; l < GRID_LEVELS; ++l){
+		levels[l].swap(other.levels[l]);
+	}
+	large.swap(other.large);
+	rects.swap(other.rects);
+}
+
+size_t ShapeGrid::size(void) const{
+	return rects.size();
+}
+
+const Rect &ShapeGrid::bounds(size_t i) const{
+	return rects[i];
+}
+
+// Look up the cells under area, unless the level has fewer cells in use
+// than that, in which case walk the ones it has
+void ShapeGrid::query(const Rect &area, size_t level, vector<size_t> &hits) const{
+	const Level &cells = levels[level];
+	Rect c = cells_of(area, level);
+	if(cells.size() > (size_t)(c.x1 - c.x0) * (size_t)(c.y1 - c.y0)){
+		for(GLint y = c.y0; y < c.y1; ++y){
+			for(GLint x = c.x0; x < c.x1; ++x){
+				Level::const_iterator cell = cells.find(Cell(x, y));
+				if(cell == cells.end()){
+					continue;
+				}
+				for(size_t j = 0; j < cell->second.size(); ++j){
+					if(rects[cell->second[j]].intersects(area)){
+						hits.push_back(cell->second[j]);
+					}
+				}
+			}
+		}
+		return;
+	}
+	for(Level::const_iterator cell = cells.begin(); cell != cells.end(); ++cell){
+		if(cell->first.first < c.x0 || cell->first.first >= c.x1 || cell->first.second < c.y0 || cell->first.second >= c.y1){
+			continue;
+		}
+		for(size_t j = 0; j < cell->second.size(); ++j){
+			if(rects[cell->second[j]].intersects(area)){
+				hits.push_back(cell->second[j]);
+			}
+		}
+	}
+}
+
+// A shape in several cells turns up once per cell, hence the unique
+void ShapeGrid::query(const Rect &area, vector<size_t> &hits) const{
+	hits.clear();
+	if(area.empty()){
+		return;
+	}
+	for(size_t level = 0; level < GRID_LEVELS; ++level){
+		query(area, level, hits);
+	}
+	for(size_t j = 0; j < large.size(); ++j){
+		if(rects[large[j]].intersects(area)){
+			hits.push_back(large[j]);
+		}
+	}
+	sort(hits.begin(), hits.end());
+	hits.erase(unique(hits.begin(), hits.end()), hits.end());
+}
@@ -0,0 +1,74 @@
+#ifndef SHAPE_GRID_H
+#define SHAPE_GRID_H
+
+#include <vector>
+#include <map>
+
+using namespace std;
+
+#include "Globals.h"
+
+// Side of a cell on the finest level in pixels. Each level's cells are
+// four times wider than the last.
+const GLint GRID_CELL = 64;
+const size_t GRID_LEVELS = 6;
+
+// A shape is filed on the finest level where its bounds cover at most
+// this many cells. Shapes too big even for the top level go on one list
+// that every query checks.
+const size_t GRID_MAX_CELLS = 16;
+
+// ShapeGrid indexes the bounds of every shape in a Scene by the grid
+// cells they overlap, so "what's near here" costs a few map lookups
+// instead of a walk over every shape. Big shapes go on coarser levels so
+// they don't have to be filed in hundreds of cells. Cells are only made
+// when a shape lands in one, so the grid has no fixed extent. Entries are
+// scene indices and follow the scene: push appends, erase renumbers.
+class ShapeGrid{
+public:
+	// Index the next shape
+	void push(const Rect &bounds);
+
+	// Index a shape at i; every shape from i on moves up one
+	void insert(size_t i, const Rect &bounds);
+
+	// Drop shape i; every later shape moves down one
+	void erase(size_t i);
+
+	// Drop every shape
+	void clear(void);
+
+	// Trade contents with another grid without copying
+	void swap(ShapeGrid &other);
+
+	// Number of shapes
+	size_t size(void) const;
+
+	// Bounds of shape i
+	const Rect &bounds(size_t i) const;
+
+	// Indices of every shape whose bounds overlap area, in scene order
+	void query(const Rect &area, vector<size_t> &hits) const;
+
+private:
+	typedef pair<GLint, GLint> Cell;
+	typedef map<Cell, vector<size_t> > Level;
+
+	// Cells covered by bounds on one level
+	Rect cells_of(const Rect &bounds, size_t level) const;
+
+	// Level a shape is filed on, or GRID_LEVELS for the large list
+	size_t level_of(const Rect &bounds) const;
+
+	// Every entry in one level that overlaps area
+	void query(const Rect &area, size_t level, vector<size_t> &hits) const;
+
+	// Add delta to every entry from first on
+	void renumber(size_t first, int delta);
+
+	Level levels[GRID_LEVELS];
+	vector<size_t> large;		// Shapes too big for cells, in scene order
+	vector<Rect> rects;			// Bounds of every shape
+};
+
+#endif
@@ -0,0 +1,386 @@
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Algorithms.h"
+#include "Layer.h"
+#include "Shape.h"
+#include "ShapeStore.h"
+#include "Perf.h"
+
+ShapeStore::ShapeStore(size_t budget_bytes):
+	shapes(),
+	grid(),
+	blocks(),
+	budget(budget_bytes),
+	used(0),
+	frame(0),
+	scratch_shapes(),
+	scratch_controls(),
+	dedup(false),
+	block_seen(),
+	scratch_seen()
+{
+}
+
+ShapeStore::~ShapeStore(){
+	for(size_t i = 0; i < blocks.size(); ++i){
+		evict(i);
+	}
+}
+
+// New shapes join the last block. Wherever that block is cached the shape
+// goes straight in, so drawing a shape doesn't cost a rebuild.
+void ShapeStore::push(const Shape &shape){
+	shapes.push(shape);
+	grid.push(shape_bounds(shape));
+	size_t block = (shapes.size() - 1) / STORE_BLOCK;
+	if(block == blocks.size()){
+		add_block();
+	}
+	Block &b = blocks[block];
+	b.bounds.unite(grid.bounds(shapes.size() - 1));
+	for(size_t t = 0; t < LOD_TIERS; ++t){
+		Tier &cached = b.tiers[t];
+		if(cached.shapes){
+			used -= cached.shapes->bytes() + cached.controls->bytes();
+			rasterize(shape, t, cached.shapes, cached.controls, 0);
+			used += cached.shapes->bytes() + cached.controls->bytes();
+		}
+	}
+}
+
+// Like erase, anything but the end shifts later shapes and their blocks
+// are rebuilt when next drawn
+void ShapeStore::insert(size_t index, const Shape &shape){
+	if(index == shapes.size()){
+		push(shape);
+		return;
+	}
+	shapes.insert(index, shape);
+	grid.insert(index, shape_bounds(shape));
+	size_t block = index / STORE_BLOCK;
+	for(size_t i = block; i < blocks.size(); ++i){
+		evict(i);
+	}
+	if(blocks.size() * STORE_BLOCK < shapes.size()){
+		add_block();
+	}
+	for(size_t i = block; i < blocks.size(); ++i){
+		bound(i);
+	}
+}
+
+// Removing the very last shape just pops its layers. Anything older shifts
+// every later shape back one, so those blocks are rebuilt when next drawn.
+// Bounds only ever shrink, so they're recomputed from the parameters.
+void ShapeStore::erase(size_t index){
+	size_t block = index / STORE_BLOCK;
+	if(index + 1 == shapes.size()){
+		for(size_t t = 0; t < LOD_TIERS; ++t){
+			Tier &cached = blocks[block].tiers[t];
+			if(!cached.shapes){
+				continue;
+			}
+			used -= cached.shapes->bytes() + cached.controls->bytes();
+			cached.shapes->pop();
+			if(shapes[index].kind == SHAPE_CURVE){
+				cached.controls->pop();
+			}
+			used += cached.shapes->bytes() + cached.controls->bytes();
+		}
+	}else{
+		for(size_t i = block; i < blocks.size(); ++i){
+			evict(i);
+		}
+	}
+	shapes.erase(index);
+	grid.erase(index);
+	size_t count = (shapes.size() + STORE_BLOCK - 1) / STORE_BLOCK;
+	for(size_t i = count; i < blocks.size(); ++i){
+		evict(i);
+	}
+	blocks.resize(count);
+	for(size_t i = block; i < blocks.size(); ++i){
+		bound(i);
+	}
+}
+
+// The grid narrows it down to shapes whose bounds are close; the newest
+// one that's actually under p wins, as it's drawn on top
+size_t ShapeStore::pick(const Point2D &p, GLint tolerance) const{
+	vector<size_t> near;
+	grid.query(Rect(p.x - tolerance, p.y - tolerance, p.x + tolerance + 1, p.y + tolerance + 1), near);
+	for(size_t i = near.size(); i > 0; --i){
+		if(shape_hit(shapes[near[i - 1]], p, tolerance)){
+			return near[i - 1];
+		}
+	}
+	return shapes.size();
+}
+
+const Rect &ShapeStore::bounds(size_t i) const{
+	return grid.bounds(i);
+}
+
+void ShapeStore::clear(void){
+	drop_cache();
+	blocks.clear();
+	shapes.clear();
+	grid.clear();
+}
+
+const Scene &ShapeStore::scene(void) const{
+	return shapes;
+}
+
+size_t ShapeStore::cached_bytes(void) const{
+	return used;
+}
+
+// Frames are swapped too, so last_used still means the same thing
+void ShapeStore::swap(ShapeStore &other){
+	shapes.swap(other.shapes);
+	grid.swap(other.grid);
+	blocks.swap(other.blocks);
+	std::swap(used, other.used);
+	std::swap(frame, other.frame);
+}
+
+void ShapeStore::drop_cache(void){
+	for(size_t i = 0; i < blocks.size(); ++i){
+		evict(i);
+	}
+}
+
+void ShapeStore::set_dedup(bool on){
+	if(on != dedup){
+		dedup = on;
+		drop_cache();
+	}
+}
+
+// Saved area to tier pixels, rounded outward
+static Rect tier_area(const Rect &area, size_t tier){
+	GLfloat zoom = lod_scale(tier);
+	return Rect((GLint)floor(area.x0 * zoom) - 1, (GLint)floor(area.y0 * zoom) - 1,
+		(GLint)ceil(area.x1 * zoom) + 1, (GLint)ceil(area.y1 * zoom) + 1);
+}
+
+// Same kernels the layers always used. Every shape adds exactly one entry
+// to shapes, and curves one to controls, which is what lets pop work.
+// Curves are flattened after scaling, so a zoomed out curve gets fewer
+// segments.
+void ShapeStore::rasterize(const Shape &saved, size_t tier, Layer *shape_layer, Layer *control_layer, Occupancy *seen){
+	Shape shape = tier == LOD_ONE ? saved : scale_shape(saved, lod_scale(tier));
+	vector<SubpixelPoint> polyline;
+	vector<Span> spans;
+	VertexWriter writer;
+	GLfloat *first = 0;
+	size_t count = 0;
+	switch(shape.kind){
+	case SHAPE_LINE:
+		if(shape_layer){
+			make_line_spans(shape.points[0], shape.points[1], spans);
+			if(seen){
+				seen->filter(spans);
+			}
+			shape_layer->push(spans);
+		}
+		break;
+	case SHAPE_CIRCLE:
+	case SHAPE_CLOCK:
+		// Filled clock faces change with their hands, so ClockHands
+		// draws them; they still take their entry here
+		if(shape_layer && shape.kind == SHAPE_CLOCK && shape.filled){
+			shape_layer->push(spans);
+		}else if(shape_layer){
+			if(shape.filled){
+				make_disc_spans(shape.points[0], shape.radius, spans);
+			}else{
+				make_circle_spans(shape.points[0], shape.radius, spans);
+			}
+			if(seen){
+				seen->filter(spans);
+			}
+			shape_layer->push(spans);
+		}
+		break;
+	case SHAPE_CURVE:
+		if(shape_layer && shape.filled){
+			flatten_curve(shape.points, 4, CURVE_FLATNESS, polyline);
+			make_polygon_spans(polyline, SHAPE_FILL_RULE, spans);
+			if(seen){
+				seen->filter(spans);
+			}
+			shape_layer->push(spans);
+		}else if(shape_layer){
+			flatten_curve(shape.points, 4, CURVE_FLATNESS, polyline);
+			writer = shape_layer->begin(polyline_size(polyline));
+			first = writer.next;
+			make_polyline(polyline, writer);
+			if(seen){
+				writer.next = seen->filter(first, writer.next);
+			}
+			shape_layer->end(writer);
+		}
+		if(control_layer){
+			for(int i = 0; i < 3; ++i){
+				count += line_size(shape.points[i], shape.points[i + 1]);
+			}
+			writer = control_layer->begin(count);
+			for(int i = 0; i < 3; ++i){
+				make_line(shape.points[i], shape.points[i + 1], writer);
+			}
+			control_layer->end(writer);
+		}
+		break;
+	}
+}
+
+void ShapeStore::build(size_t block, size_t tier, Layer *shape_layer, Layer *control_layer, Occupancy *seen){
+	size_t end = (block + 1) * STORE_BLOCK < shapes.size() ? (block + 1) * STORE_BLOCK : shapes.size();
+	for(size_t i = block * STORE_BLOCK; i < end; ++i){
+		rasterize(shapes[i], tier, shape_layer, control_layer, seen);
+	}
+}
+
+void ShapeStore::build(size_t block, size_t tier, const vector<size_t> &only, Layer *shape_layer, Layer *control_layer, Occupancy *seen){
+	vector<size_t>::const_iterator i = lower_bound(only.begin(), only.end(), block * STORE_BLOCK);
+	for(; i != only.end() && *i < (block + 1) * STORE_BLOCK; ++i){
+		rasterize(shapes[*i], tier, shape_layer, control_layer, seen);
+	}
+}
+
+void ShapeStore::add_block(void){
+	Block empty;
+	for(size_t t = 0; t < LOD_TIERS; ++t){
+		Tier none = {0, 0, 0};
+		empty.tiers[t] = none;
+	}
+	blocks.push_back(empty);
+}
+
+void ShapeStore::bound(size_t block){
+	size_t end = (block + 1) * STORE_BLOCK < shapes.size() ? (block + 1) * STORE_BLOCK : shapes.size();
+	blocks[block].bounds = Rect();
+	for(size_t i = block * STORE_BLOCK; i < end; ++i){
+		blocks[block].bounds.unite(grid.bounds(i));
+	}
+}
+
+// Least recently drawn goes first. Blocks already drawn this frame are
+// off limits, or a scene bigger than the budget would evict and rebuild
+// everything every frame.
+bool ShapeStore::make_room(void){
+	while(used >= budget){
+		const Tier *oldest = 0;
+		size_t oldest_block = 0, oldest_tier = 0;
+		for(size_t i = 0; i < blocks.size(); ++i){
+			for(size_t t = 0; t < LOD_TIERS; ++t){
+				const Tier &cached = blocks[i].tiers[t];
+				if(cached.shapes && cached.last_used < frame && (!oldest || cached.last_used < oldest->last_used)){
+					oldest = &cached;
+					oldest_block = i;
+					oldest_tier = t;
+				}
+			}
+		}
+		if(!oldest){
+			return false;
+		}
+		evict(oldest_block, oldest_tier);
+	}
+	return true;
+}
+
+void ShapeStore::evict(size_t block, size_t tier){
+	Tier &cached = blocks[block].tiers[tier];
+	if(!cached.shapes){
+		return;
+	}
+	used -= cached.shapes->bytes() + cached.controls->bytes();
+	delete cached.shapes;
+	delete cached.controls;
+	cached.shapes = 0;
+	cached.controls = 0;
+}
+
+void ShapeStore::evict(size_t block){
+	for(size_t t = 0; t < LOD_TIERS; ++t){
+		evict(block, t);
+	}
+}
+
+// Blocks that don't fit are rasterized into the scratch layers, drawn,
+// and thrown away; only their visible shapes, as found by the grid, are
+// built. Blocks off screen are left as they are: not built, and not
+// touched, so they're the first to go when room is needed.
+//
+// With dedup on, a block being cached is checked against itself, over
+// its own area. Scratch blocks only have to cover the window, so they're
+// checked against every scratch block before them this frame.
+void ShapeStore::draw(const Rect &visible, size_t tier){
+	vector<size_t> hits;
+	bool queried = false;
+	Occupancy *scratch = 0;
+	++frame;
+	for(size_t i = 0; i < blocks.size(); ++i){
+		Block &b = blocks[i];
+		Tier &cached = b.tiers[tier];
+		if(!b.bounds.intersects(visible)){
+			continue;
+		}
+		if(!cached.shapes && make_room()){
+			PerfTimer timer(PERF_GEOMETRY);
+			cached.shapes = new Layer;
+			cached.controls = new Layer;
+			Occupancy *seen = dedup && block_seen.reset(tier_area(b.bounds, tier)) ? &block_seen : 0;
+			build(i, tier, cached.shapes, cached.controls, seen);
+			used += cached.shapes->bytes() + cached.controls->bytes();
+		}
+		if(cached.shapes){
+			cached.last_used = frame;
+			cached.shapes->draw();
+		}else{
+			{
+				PerfTimer timer(PERF_GEOMETRY);
+				if(!queried){
+					grid.query(visible, hits);
+					queried = true;
+					scratch = dedup && scratch_seen.reset(tier_area(visible, tier)) ? &scratch_seen : 0;
+				}
+				scratch_shapes.clear();
+				build(i, tier, hits, &scratch_shapes, 0, scratch);
+			}
+			scratch_shapes.draw();
+		}
+	}
+}
+
+void ShapeStore::draw_controls(const Rect &visible, size_t tier){
+	vector<size_t> hits;
+	bool queried = false;
+	for(size_t i = 0; i < blocks.size(); ++i){
+		Tier &cached = blocks[i].tiers[tier];
+		if(!blocks[i].bounds.intersects(visible)){
+			continue;
+		}
+		if(cached.controls){
+			cached.controls->draw();
+		}else{
+			{
+				PerfTimer timer(PERF_GEOMETRY);
+				if(!queried){
+					grid.query(visible, hits);
+					queried = true;
+				}
+				scratch_controls.clear();
+				build(i, tier, hits, 0, &scratch_controls, 0);
+			}
+			scratch_controls.draw();
+		}
+	}
+}
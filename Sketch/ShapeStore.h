@@ -0,0 +1,152 @@
+#ifndef SHAPE_STORE_H
+#define SHAPE_STORE_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Layer.h"
+#include "Shape.h"
+#include "ShapeGrid.h"
+#include "Occupancy.h"
+
+// Shapes per cache block
+const size_t STORE_BLOCK = 256;
+
+// Most bytes of rasterized vertices the store keeps around
+const size_t STORE_BUDGET = 64 * 1024 * 1024;
+
+// Zoom levels shapes are rasterized at: tier t draws them lod_scale(t)
+// times their saved size, from 1/8 up to 8, with LOD_ONE at 1
+const size_t LOD_TIERS = 7;
+const size_t LOD_ONE = 3;
+
+inline GLfloat lod_scale(size_t tier){
+	return tier < LOD_ONE ? 1.0f / (1 << (LOD_ONE - tier)) : (GLfloat)(1 << (tier - LOD_ONE));
+}
+
+// ShapeStore keeps saved shapes as parameters (a Scene) and treats their
+// pixels as a cache. The scene is cut into blocks of STORE_BLOCK shapes;
+// a block is only rasterized (into a pair of Layers) when it's first
+// drawn, and the least recently drawn blocks are evicted when the cache
+// goes over budget. Past that point blocks are drawn straight from a
+// scratch layer and not kept, so memory stays O(shapes) plus the budget
+// however big the scene gets. Each block also keeps the bounds of its
+// shapes, so blocks entirely outside the window are never rasterized, and
+// a ShapeGrid over every shape answers questions about a single point or
+// area without touching the rest.
+//
+// Each LOD tier is cached separately, from the shapes scaled up or down
+// before they're rasterized, so every zoom level is pixel exact and
+// zooming out makes fewer pixels rather than more. The budget is shared:
+// a tier that isn't being looked at ages out like any other block.
+class ShapeStore{
+public:
+	ShapeStore(size_t budget = STORE_BUDGET);
+	~ShapeStore();
+
+	// Append one shape
+	void push(const Shape &shape);
+
+	// Put a shape back at i, moving later shapes up one
+	void insert(size_t i, const Shape &shape);
+
+	// Remove shape i
+	void erase(size_t i);
+
+	// Index of the newest shape within tolerance of p, or scene().size()
+	// if there isn't one
+	size_t pick(const Point2D &p, GLint tolerance) const;
+
+	// Screen area shape i covers
+	const Rect &bounds(size_t i) const;
+
+	// Remove every shape
+	void clear(void);
+
+	// Every shape, in drawing order
+	const Scene &scene(void) const;
+
+	// Draw every shape that might touch visible (in saved coordinates) at
+	// one LOD tier, caching as many blocks as the budget allows
+	void draw(const Rect &visible, size_t tier);
+
+	// Draw the control polygons of every curve that might touch visible
+	void draw_controls(const Rect &visible, size_t tier);
+
+	// Bytes of vertices currently cached
+	size_t cached_bytes(void) const;
+
+	// Trade every shape, and the cache that goes with them, with another
+	// store. Nothing is copied or rebuilt.
+	void swap(ShapeStore &other);
+
+	// Drop every cached pixel; they're made again when next drawn
+	void drop_cache(void);
+
+	// Drop pixels that shapes drawn earlier already cover when blocks are
+	// built, within each block, and across every block that's drawn
+	// without being cached. Shapes added to a block that's already built
+	// aren't checked. Changing it drops the cache.
+	void set_dedup(bool on);
+
+private:
+	// One block's cached pixels at one tier, or nothing while it's evicted
+	struct Tier{
+		Layer *shapes;
+		Layer *controls;
+		size_t last_used;		// Frame it was last drawn
+	};
+
+	struct Block{
+		Tier tiers[LOD_TIERS];
+		Rect bounds;			// Covers every shape in the block
+	};
+
+	// Rasterize one shape, or a whole block, onto a pair of layers at one
+	// tier. Either layer can be null to skip it. Shape pixels already in
+	// seen are left out, if it isn't null.
+	void rasterize(const Shape &shape, size_t tier, Layer *shape_layer, Layer *control_layer, Occupancy *seen);
+	void build(size_t block, size_t tier, Layer *shape_layer, Layer *control_layer, Occupancy *seen);
+
+	// Rasterize just the shapes of a block listed in only (sorted)
+	void build(size_t block, size_t tier, const vector<size_t> &only, Layer *shape_layer, Layer *control_layer, Occupancy *seen);
+
+	// Start a new, empty block at the end
+	void add_block(void);
+
+	// Recompute a block's bounds from its shapes
+	void bound(size_t block);
+
+	// Make room for a block, evicting tiers not drawn this frame. False
+	// if the budget is still used up.
+	bool make_room(void);
+
+	// Drop a block's cached pixels at one tier, or at every tier
+	void evict(size_t block, size_t tier);
+	void evict(size_t block);
+
+	Scene shapes;
+	ShapeGrid grid;
+	vector<Block> blocks;
+	size_t budget;
+	size_t used;				// Bytes in cached blocks
+	size_t frame;				// Bumped every draw
+
+	// Where blocks that don't fit the budget are drawn from
+	Layer scratch_shapes;
+	Layer scratch_controls;
+
+	// Pixels drawn so far, with dedup on: in the block being built, and
+	// in the scratch blocks drawn this frame
+	bool dedup;
+	Occupancy block_seen;
+	Occupancy scratch_seen;
+
+	// Stores own layers; no copying
+	ShapeStore(ShapeStore const&);
+	void operator=(ShapeStore const&);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "Globals.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <emmintrin.h>
+#define SKETCH_SSE2
+#endif
+
+#ifdef SKETCH_SSE2
+
+// Does this CPU have SSE2? Always true on x64. Asked once; anything
+// built with SKETCH_SSE2 has to check this before using it.
+inline bool use_sse2(void){
+	static int state = -1;
+	if(state < 0){
+#ifdef _M_X64
+		state = 1;
+#else
+		int info[4];
+		__cpuid(info, 1);
+		state = (info[3] & (1 << 26)) != 0 ? 1 : 0;
+#endif
+	}
+	return state == 1;
+}
+
+#endif
+
+#endif
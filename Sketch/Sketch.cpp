@@ -7,13 +7,14 @@ int main(int argc, char **argv){
    // Initialization functions
    glutInit(&argc, argv);                         
    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);  
-   glutInitWindowSize(WIDTH, HEIGHT);     
-   glutInitWindowPosition (WIDTH/2, HEIGHT/2);
+   glutInitWindowSize(DEFAULT_WIDTH, DEFAULT_HEIGHT);     
+   glutInitWindowPosition (DEFAULT_WIDTH/2, DEFAULT_HEIGHT/2);
    glutCreateWindow("Sketch");
    
    // Call-back functions
    glutDisplayFunc(DrawContext::Display);
    glutKeyboardFunc(DrawContext::Keyboard);
+   glutSpecialFunc(DrawContext::Special);
    glutMouseFunc(DrawContext::Mouse);
    glutPassiveMotionFunc(DrawContext::Motion);
    glutMotionFunc(DrawContext::Motion);
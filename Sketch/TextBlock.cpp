@@ -0,0 +1,66 @@
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "Globals.h"
+#include "TextBlock.h"
+
+TextBlock::TextBlock():
+	list(0),
+	text(),
+	x(0.0f),
+	y(0.0f)
+{
+	color[0] = color[1] = color[2] = 0.0f;
+}
+
+TextBlock::~TextBlock(){
+	if(list){
+		glDeleteLists(list, 1);
+	}
+}
+
+void TextBlock::set(const vector<string> &lines, GLfloat nx, GLfloat ny, const float *c){
+	if(list && lines == text && placed(nx, ny, c)){
+		return;
+	}
+	text = lines;
+	x = nx;
+	y = ny;
+	for(size_t i = 0; i < 3; ++i){
+		color[i] = c[i];
+	}
+	if(!list){
+		list = glGenLists(1);
+	}
+
+	// The raster color is latched by glRasterPos, so it goes first. Each
+	// line starts from its own raster position; the font is 13 rows high.
+	glNewList(list, GL_COMPILE);
+	glColor3fv(color);
+	for(size_t i = 0; i < text.size(); ++i){
+		glRasterPos2f(x, y + 13 * i);
+		for(size_t j = 0; j < text[i].length(); ++j){
+			glutBitmapCharacter(GLUT_BITMAP_8_BY_13, text[i][j]);
+		}
+	}
+	glEndList();
+}
+
+void TextBlock::set(const char *line, GLfloat nx, GLfloat ny, const float *c){
+	if(list && text.size() == 1 && text[0] == line && placed(nx, ny, c)){
+		return;
+	}
+	set(vector<string>(1, line), nx, ny, c);
+}
+
+void TextBlock::draw(void) const{
+	if(list){
+		glCallList(list);
+	}
+}
+
+bool TextBlock::placed(GLfloat nx, GLfloat ny, const float *c) const{
+	return nx == x && ny == y && c[0] == color[0] && c[1] == color[1] && c[2] == color[2];
+}
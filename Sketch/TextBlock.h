@@ -0,0 +1,46 @@
+#ifndef TEXT_BLOCK_H
+#define TEXT_BLOCK_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "Globals.h"
+
+// TextBlock is a few lines of bitmap text, laid out once into a display
+// list. The glyph bitmaps are copied into the list when it's compiled, so
+// drawing it again is one glCallList rather than a GLUT call, with all its
+// pixel store setup, per character. Lines are only laid out again when
+// their text, position or color changes.
+class TextBlock{
+public:
+	TextBlock();
+	~TextBlock();
+
+	// Lay out lines one below the other starting at (x, y), unless that's
+	// what the block already holds
+	void set(const vector<string> &lines, GLfloat x, GLfloat y, const float *color);
+
+	// One line, same as above. Checking an unchanged line allocates
+	// nothing, so it's cheap to call every frame.
+	void set(const char *line, GLfloat x, GLfloat y, const float *color);
+
+	// Draw whatever was last set
+	void draw(void) const;
+
+private:
+	// Is the block already at (x, y) in this color?
+	bool placed(GLfloat x, GLfloat y, const float *color) const;
+
+	GLuint list;				// Display list, 0 until first set
+	vector<string> text;		// What's in it, and where
+	GLfloat x, y;
+	float color[3];
+
+	// Owns a display list; no copying
+	TextBlock(TextBlock const&);
+	void operator=(TextBlock const&);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include <vector>
+#include <process.h>
+
+using namespace std;
+
+#include "Globals.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(GLint threads):
+	workers(),
+	job(0),
+	remaining(0),
+	stopping(0),
+	done(CreateEvent(NULL, FALSE, FALSE, NULL))
+{
+	if(threads <= 0){
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		threads = (GLint)info.dwNumberOfProcessors;
+	}
+	if(threads < 1){
+		threads = 1;
+	}
+	for(GLint i = 0; i < threads; ++i){
+		Worker *worker = new Worker;
+		worker->pool = this;
+		worker->index = i;
+		worker->thread = 0;
+		worker->wake = CreateEvent(NULL, FALSE, FALSE, NULL);
+		worker->head = 0;
+		InitializeCriticalSection(&worker->lock);
+		workers.push_back(worker);
+	}
+	for(GLint i = 1; i < threads; ++i){
+		workers[i]->thread = (HANDLE)_beginthreadex(NULL, 0, thread_main, workers[i], 0, NULL);
+	}
+}
+
+ThreadPool::~ThreadPool(){
+	InterlockedExchange(&stopping, 1);
+	for(size_t i = 1; i < workers.size(); ++i){
+		SetEvent(workers[i]->wake);
+		WaitForSingleObject(workers[i]->thread, INFINITE);
+		CloseHandle(workers[i]->thread);
+	}
+	for(size_t i = 0; i < workers.size(); ++i){
+		CloseHandle(workers[i]->wake);
+		DeleteCriticalSection(&workers[i]->lock);
+		delete workers[i];
+	}
+	CloseHandle(done);
+}
+
+GLint ThreadPool::size(void) const{
+	return (GLint)workers.size();
+}
+
+// Sleep until there's a run, help finish it, repeat
+unsigned __stdcall ThreadPool::thread_main(void *arg){
+	Worker *self = (Worker*)arg;
+	for(;;){
+		WaitForSingleObject(self->wake, INFINITE);
+		if(self->pool->stopping){
+			return 0;
+		}
+		self->pool->work(self->index);
+	}
+}
+
+// Deal indices out in contiguous blocks, so neighbouring tasks (which
+// tend to touch neighbouring memory) start on the same thread
+void ThreadPool::run(Job &work_job, size_t count){
+	if(!count){
+		return;
+	}
+	job = &work_job;
+	remaining = (LONG)count;
+	size_t n = workers.size();
+	for(size_t i = 0; i < n; ++i){
+		Worker *worker = workers[i];
+		EnterCriticalSection(&worker->lock);
+		worker->tasks.clear();
+		worker->head = 0;
+		for(size_t t = count * i / n; t < count * (i + 1) / n; ++t){
+			worker->tasks.push_back(t);
+		}
+		LeaveCriticalSection(&worker->lock);
+	}
+	for(size_t i = 1; i < n; ++i){
+		SetEvent(workers[i]->wake);
+	}
+	work(0);
+	WaitForSingleObject(done, INFINITE);
+	job = 0;
+}
+
+bool ThreadPool::next(GLint self, size_t &task){
+	Worker *own = workers[self];
+	EnterCriticalSection(&own->lock);
+	if(own->head < own->tasks.size()){
+		task = own->tasks.back();
+		own->tasks.pop_back();
+		LeaveCriticalSection(&own->lock);
+		return true;
+	}
+	LeaveCriticalSection(&own->lock);
+
+	// Steal from the front, the far end from where the owner works
+	for(size_t i = 1; i < workers.size(); ++i){
+		Worker *victim = workers[(self + i) % workers.size()];
+		EnterCriticalSection(&victim->lock);
+		if(victim->head < victim->tasks.size()){
+			task = victim->tasks[victim->head++];
+			LeaveCriticalSection(&victim->lock);
+			return true;
+		}
+		LeaveCriticalSection(&victim->lock);
+	}
+	return false;
+}
+
+void ThreadPool::work(GLint self){
+	size_t task;
+	while(next(self, task)){
+		job->run(task);
+		if(InterlockedDecrement(&remaining) == 0){
+			SetEvent(done);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+
+// Job is one parallel loop: run is called once for every index, from
+// whichever thread gets to it.
+struct Job{
+	virtual ~Job() {}
+	virtual void run(size_t index) = 0;
+};
+
+// ThreadPool runs Jobs on a fixed set of Win32 threads. Each thread has
+// its own queue of indices; it works from the back of its own queue and
+// steals from the front of the others' when it runs dry, so uneven tasks
+// still keep every core busy. The calling thread works too, and run
+// returns once every index is done.
+class ThreadPool{
+public:
+	// 0 threads means one per core
+	ThreadPool(GLint threads = 0);
+	~ThreadPool();
+
+	// Call job.run(i) for every i below count
+	void run(Job &job, size_t count);
+
+	// Threads working on a run, counting the caller
+	GLint size(void) const;
+
+private:
+	struct Worker{
+		ThreadPool *pool;
+		GLint index;
+		HANDLE thread;
+		HANDLE wake;				// Set when there's a new run
+		CRITICAL_SECTION lock;		// Guards tasks and head
+		vector<size_t> tasks;
+		size_t head;				// Front of the queue, for thieves
+	};
+
+	static unsigned __stdcall thread_main(void *arg);
+
+	// Take an index, from our own queue first
+	bool next(GLint self, size_t &task);
+
+	// Run tasks until there are none left anywhere
+	void work(GLint self);
+
+	vector<Worker*> workers;		// workers[0] is the calling thread
+	Job *job;
+	volatile LONG remaining;		// Indices not yet finished
+	volatile LONG stopping;
+	HANDLE done;					// Set when remaining hits 0
+
+	// Pools own threads; no copying
+	ThreadPool(ThreadPool const&);
+	void operator=(ThreadPool const&);
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include <vector>
+
+using namespace std;
+
+#include "Globals.h"
+#include "Raster.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+#include "TileRender.h"
+
+namespace{
+	// One chunk of shapes' spans (or anti-aliased runs), sorted by tile.
+	// Tile t's are spans[start[t]] up to spans[start[t + 1]], still in
+	// shape order. Runs keep their coverage where it was written.
+	struct Bins{
+		vector<Span> spans;
+		CoverageSpans runs;
+		vector<size_t> start;
+	};
+
+	// Part of a vertical span, rows x0 through x1
+	Span piece(const Span &s, GLint x0, GLint x1){
+		return Span(s.y, x0, x1, true);
+	}
+	CoverageSpan piece(const CoverageSpan &s, GLint x0, GLint x1){
+		return CoverageSpan(s.y, x0, x1, true, s.pair, s.first + (x0 - s.x0));
+	}
+
+	// A horizontal run and the row paired with it have to land in the
+	// same tile, both on the raster, to be binned as one. Any that don't
+	// are split in two in place, the paired row getting its coverage
+	// written out.
+	void split_pairs(CoverageSpans &runs, GLint height){
+		vector<CoverageSpan> split;
+		split.reserve(runs.spans.size());
+		for(size_t i = 0; i < runs.spans.size(); ++i){
+			const CoverageSpan &s = runs.spans[i];
+			GLint y = s.y + s.pair;
+			if(s.vertical || !s.pair || (s.y >= 0 && s.y < height && y >= 0 && y < height && s.y / TILE_ROWS == y / TILE_ROWS)){
+				split.push_back(s);
+				continue;
+			}
+			GLuint first = (GLuint)runs.coverage.size();
+			for(GLint x = 0; x <= s.x1 - s.x0; ++x){
+				runs.coverage.push_back(255 - runs.coverage[s.first + x]);
+			}
+			split.push_back(CoverageSpan(s.y, s.x0, s.x1, false, 0, s.first));
+			split.push_back(CoverageSpan(y, s.x0, s.x1, false, 0, first));
+		}
+		runs.spans.swap(split);
+	}
+
+	// Clip rows to the raster and cut vertical spans at tile edges, so
+	// every piece belongs to one tile, then sort them by tile into out
+	template<class S>
+	void bin(const vector<S> &spans, GLint height, GLint tiles, vector<S> &out, vector<size_t> &start){
+		vector<S> pieces;
+		vector<GLint> tile_of;
+		for(size_t i = 0; i < spans.size(); ++i){
+			const S &s = spans[i];
+			if(!s.vertical){
+				if(s.y >= 0 && s.y < height){
+					pieces.push_back(s);
+					tile_of.push_back(s.y / TILE_ROWS);
+				}
+				continue;
+			}
+			GLint row0 = s.x0 < 0 ? 0 : s.x0;
+			GLint row1 = s.x1 >= height ? height - 1 : s.x1;
+			while(row0 <= row1){
+				GLint tile = row0 / TILE_ROWS;
+				GLint last = (tile + 1) * TILE_ROWS - 1;
+				pieces.push_back(piece(s, row0, last < row1 ? last : row1));
+				tile_of.push_back(tile);
+				row0 = last + 1;
+			}
+		}
+
+		// Stable counting sort by tile
+		start.assign(tiles + 1, 0);
+		for(size_t i = 0; i < pieces.size(); ++i){
+			start[tile_of[i] + 1] += 1;
+		}
+		for(GLint t = 0; t < tiles; ++t){
+			start[t + 1] += start[t];
+		}
+		vector<size_t> next(start.begin(), start.end() - 1);
+		out.resize(pieces.size());
+		for(size_t i = 0; i < pieces.size(); ++i){
+			out[next[tile_of[i]]++] = pieces[i];
+		}
+	}
+
+	// Pass 1: rasterize a chunk of shapes and bin the spans
+	struct BinJob : Job{
+		BinJob(const Scene &s, TimeAngle &t, bool c, bool sm, GLfloat sc, GLint h, vector<Bins> &b):
+			scene(s), ta(t), control(c), smooth(sm), scale(sc), height(h), tiles((h + TILE_ROWS - 1) / TILE_ROWS), bins(b) {}
+
+		void run(size_t index){
+			vector<Span> spans;
+			CoverageSpans runs;
+			size_t end = (index + 1) * TILE_CHUNK < scene.size() ? (index + 1) * TILE_CHUNK : scene.size();
+			for(size_t i = index * TILE_CHUNK; i < end; ++i){
+				// Bigger exports are drawn again from bigger parameters,
+				// not by blowing up pixels
+				Shape shape = scale == 1.0f ? scene[i] : scale_shape(scene[i], scale);
+				if(smooth && control){
+					control_coverage(shape, runs);
+				}else if(smooth){
+					shape_coverage(shape, ta, runs);
+				}else if(control){
+					control_spans(shape, spans);
+				}else{
+					shape_spans(shape, ta, spans);
+				}
+			}
+			Bins &out = bins[index];
+			if(smooth){
+				split_pairs(runs, height);
+				out.runs.coverage.swap(runs.coverage);
+				bin(runs.spans, height, tiles, out.runs.spans, out.start);
+			}else{
+				bin(spans, height, tiles, out.spans, out.start);
+			}
+		}
+
+		const Scene &scene;
+		TimeAngle &ta;
+		bool control;
+		bool smooth;
+		GLfloat scale;
+		GLint height;
+		GLint tiles;
+		vector<Bins> &bins;
+	};
+
+	// Pass 2: fill one tile from every chunk's bin, in chunk order
+	struct FillJob : Job{
+		FillJob(vector<Bins> &b, bool sm, Raster &r): bins(b), smooth(sm), raster(r) {}
+
+		void run(size_t tile){
+			for(size_t c = 0; c < bins.size(); ++c){
+				const Bins &b = bins[c];
+				for(size_t i = b.start[tile]; i < b.start[tile + 1]; ++i){
+					if(smooth){
+						raster.blend(b.runs.spans[i], &b.runs.coverage[0]);
+					}else{
+						raster.fill(b.spans[i]);
+					}
+				}
+			}
+		}
+
+		vector<Bins> &bins;
+		bool smooth;
+		Raster &raster;
+	};
+
+	void render_pass(const Scene &scene, TimeAngle &ta, bool control, bool smooth, GLfloat scale, Raster &raster, ThreadPool &pool){
+		vector<Bins> bins((scene.size() + TILE_CHUNK - 1) / TILE_CHUNK);
+		BinJob binner(scene, ta, control, smooth, scale, raster.height, bins);
+		pool.run(binner, bins.size());
+		FillJob fill(bins, smooth, raster);
+		pool.run(fill, binner.tiles);
+	}
+}
+
+void render_tiles(const Scene &scene, TimeAngle &ta, bool control, Raster &raster, ThreadPool &pool, GLfloat scale, bool smooth){
+	render_pass(scene, ta, false, smooth, scale, raster, pool);
+	if(control){
+		raster.set_color(GREEN);
+		render_pass(scene, ta, true, smooth, scale, raster, pool);
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef TILE_RENDER_H
+#define TILE_RENDER_H
+
+#include "Globals.h"
+#include "Raster.h"
+#include "Shape.h"
+#include "ThreadPool.h"
+
+// Rows per tile. Tiles run the full width of the raster, so a horizontal
+// span always lands in exactly one and rows never straddle two threads.
+const GLint TILE_ROWS = 32;
+
+// Shapes rasterized per task in the binning pass
+const size_t TILE_CHUNK = 256;
+
+// Draw every shape in scene into raster with the current color, then the
+// control polygons of its curves in GREEN when control is set. Work is
+// split over pool in two passes: shapes are rasterized into spans and
+// binned by tile, then each tile is filled from its bins in scene order.
+// Every pixel is written by one thread in the same order a single thread
+// would use, so the result doesn't depend on the thread count. Shapes are
+// scaled by scale first, for rasters bigger than the window, and drawn
+// anti-aliased when smooth is set.
+void render_tiles(const Scene &scene, TimeAngle &ta, bool control, Raster &raster, ThreadPool &pool, GLfloat scale = 1.0f, bool smooth = false);
+
+#endif
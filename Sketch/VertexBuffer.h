@@ -6,11 +6,88 @@
 using namespace std;
 
 #include "Globals.h"
+#include "Raster.h"
+#include "Extensions.h"
 
-// VertexBuffer stores and draws calculated pixel data
+// Number of pixels covered by spans
+inline size_t span_pixels(vector<Span> &spans){
+	size_t pixel_count = 0;
+	for(size_t i = 0; i < spans.size(); ++i){
+		pixel_count += spans[i].x1 - spans[i].x0 + 1;
+	}
+	return pixel_count;
+}
+
+// Spans only save vertices when runs average more than two pixels
+inline bool spans_pay_off(vector<Span> &spans, size_t pixel_count){
+	return 2 * spans.size() < pixel_count;
+}
+
+// A span becomes one GL_LINES segment along its row (or column), ending
+// one past x1 since GL leaves off the last pixel of a line. Like every
+// vertex, it lands on pixel centers through the half-pixel offset in the
+// projection. Written as GLfloats or GLshorts; returns the next free
+// vertex.
+template<class T>
+inline T *span_vertices(const Span &span, T *v){
+	T mid = (T)span.y;
+	T begin = (T)span.x0;
+	T end = (T)(span.x1 + 1);
+	if(span.vertical){
+		v[0] = mid;
+		v[1] = begin;
+		v[2] = mid;
+		v[3] = end;
+	}else{
+		v[0] = begin;
+		v[1] = mid;
+		v[2] = end;
+		v[3] = mid;
+	}
+	return v + 4;
+}
+
+// A span as one GL_POINTS vertex per pixel. Returns the next free vertex.
+template<class T>
+inline T *span_point_vertices(const Span &span, T *v){
+	for(GLint x = span.x0; x <= span.x1; ++x, v += 2){
+		v[0] = (T)(span.vertical ? span.y : x);
+		v[1] = (T)(span.vertical ? x : span.y);
+	}
+	return v;
+}
+
+// Draw count vertices into a CPU framebuffer. Line vertices turn back
+// into spans.
+template<class T>
+inline void raster_vertices(GLenum mode, const T *vertices, GLint count, Raster &raster){
+	if(mode == GL_LINES){
+		for(GLint v = 0; v + 1 < count; v += 2, vertices += 4){
+			GLint x0 = (GLint)floor((double)vertices[0]);
+			GLint y0 = (GLint)floor((double)vertices[1]);
+			GLint x1 = (GLint)floor((double)vertices[2]);
+			GLint y1 = (GLint)floor((double)vertices[3]);
+			if(y0 == y1){
+				raster.fill(Span(y0, x0, x1 - 1, false));
+			}else{
+				raster.fill(Span(x0, y0, y1 - 1, true));
+			}
+		}
+		return;
+	}
+	for(GLint v = 0; v < count; ++v, vertices += 2){
+		raster.plot((GLint)vertices[0], (GLint)vertices[1]);
+	}
+}
+
+// VertexBuffer stores and draws calculated pixel data. Temporary buffers
+// are drawn straight from host memory; saved shapes live in a Layer.
+// Temporary pixels are wherever the mouse is in draw space, so they stay
+// floats, sized to exactly the vertices written.
 struct VertexBuffer{
 	VertexBuffer(vector<Point2D> &points){
-		size = 2 * (points.size() + 1);
+		mode = GL_POINTS;
+		size = 2 * points.size();
 		vertices = new float[size];
 		for(size_t v = 0, i = 0; i < points.size(); v += 2, i += 1){
 			vertices[v] = points[i].x;
@@ -18,6 +95,46 @@ struct VertexBuffer{
 		};
 	};
 
+	// Room for up to max_pixels points, filled in place through writer()
+	// and then trimmed with finish(). Sizes come from line_size and friends.
+	VertexBuffer(size_t max_pixels){
+		mode = GL_POINTS;
+		size = 2 * max_pixels;
+		vertices = new float[size];
+	};
+
+	VertexWriter writer(void){
+		return VertexWriter(vertices);
+	};
+
+	// Keep only what the writer wrote
+	void finish(const VertexWriter &out){
+		size = out.next - vertices;
+	};
+
+	// Spans are drawn as GL_LINES, or as points when runs are too short
+	// to save any vertices.
+	VertexBuffer(vector<Span> &spans){
+		size_t pixel_count = span_pixels(spans);
+		if(spans_pay_off(spans, pixel_count)){
+			mode = GL_LINES;
+			size = 4 * spans.size();
+			vertices = new float[size];
+			GLfloat *v = vertices;
+			for(size_t i = 0; i < spans.size(); ++i){
+				v = span_vertices(spans[i], v);
+			}
+		}else{
+			mode = GL_POINTS;
+			size = 2 * pixel_count;
+			vertices = new float[size];
+			GLfloat *v = vertices;
+			for(size_t i = 0; i < spans.size(); ++i){
+				v = span_point_vertices(spans[i], v);
+			}
+		}
+	};
+
 	~VertexBuffer(){
 		delete[] vertices;
 	};
@@ -25,12 +142,18 @@ struct VertexBuffer{
 	void draw(void){
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glVertexPointer(2, GL_FLOAT, 0, vertices);
-		glDrawArrays(GL_POINTS, 0, size/2);
+		glDrawArrays(mode, 0, size/2);
 		glDisableClientState(GL_VERTEX_ARRAY);
 	};
 
+	// Same pixels, drawn into a CPU framebuffer instead of GL
+	void draw(Raster &raster){
+		raster_vertices(mode, vertices, size/2, raster);
+	};
+
 	GLfloat *vertices;
 	GLint size;
+	GLenum mode;			// GL_POINTS or GL_LINES
 };
 
 #endif